@@ -0,0 +1,265 @@
+/* Microbenchmarks for the GOVOL LISP interpreter core.
+
+   The interpreter in main.c is included here with its REPL left out, so
+   that the hot primitives can be timed in isolation:
+
+     newloc   - allocating list cells from the free space list
+     numatom  - number table lookups at different fill factors
+     ordatom  - atom table lookups at different fill factors
+     gcmark   - marking a deep (CAR-recursive) and a wide (CDR-chained) list
+     gc       - full collections with different amounts of live list cells
+     list     - walking down a list and collecting with it live, for a
+                compact list and one of list area nodes, per node
+     dvector  - the VSUM and VDOT kernels of every variant the CPU supports,
+                per element
+
+   Every figure is given in nanoseconds per operation.
+
+   Build and run (in the sourcecode directory):
+     gcc -O2 -pthread -o govolbench bench.c -lm
+     ./govolbench
+*/
+#define GOVOL_NOMAIN
+#include "main.c"
+
+#define ROUNDS 200      /* repetitions of every timed loop */
+
+void report(char *what, double ns, long ops)
+{
+    printf("%-32s %10.2f ns/op  (%ld ops)\n", what, ns/ops, ops);
+}
+
+int32 benchroot;    /* the atom whose value keeps the live test data reachable */
+
+void resetheap(struct Lispctx *cx)
+/* drop everything the previous benchmark built and collect it */
+{
+    cx->Atab[benchroot].L = cx->nilptr;
+    gc(cx, GC_CALL);
+}
+
+void bench_newloc(struct Lispctx *cx)
+{
+    int32 i, r, k;
+    long ops = 0;
+    double t, sum = 0.0;
+
+    for (r=0; r<ROUNDS; r++)
+    {
+        resetheap(cx);
+        k = cx->numf - 10;  /* stay clear of the out-of-space collection */
+        t = nsclock();
+        for (i=0; i<k; i++) newloc(cx, cx->nilptr, cx->nilptr);
+        sum += nsclock()-t;
+        ops += k;
+    }
+    report("newloc", sum, ops);
+}
+
+void bench_numatom(struct Lispctx *cx, int16 pct)
+{
+    int32 i, r, k;
+    long ops = 0;
+    double t, sum = 0.0;
+    char what[40];
+
+    /* numbers are only kept by gc() if they are reachable, so they are
+       hung on the benchmark root as we go. */
+    resetheap(cx);
+    k = n*pct/100 - cx->nnums;
+    for (i=0; i<k; i++)
+        cx->Atab[benchroot].L = newloc(cx, numatom(cx, i*1.5 + 0.25), cx->Atab[benchroot].L);
+
+    for (r=0; r<ROUNDS; r++)
+    {
+        t = nsclock();
+        for (i=0; i<k; i++) numatom(cx, i*1.5 + 0.25);
+        sum += nsclock()-t;
+        ops += k;
+    }
+    sprintf(what, "numatom hit, %d%% full", pct);
+    report(what, sum, ops);
+}
+
+void bench_ordatom(struct Lispctx *cx, int16 pct)
+{
+    int32 i, r, k, used;
+    long ops = 0;
+    double t, sum = 0.0;
+    char what[40], name[16];
+
+    /* atoms are never collected, so the table only grows from bench to bench */
+    for (used=0, i=0; i<m; i++)
+        if (cx->Atab[i].name[0] != EOS) used++;
+    for (i=0; used<m*pct/100; i++, used++)
+    {
+        sprintf(name, "B%dX%d", pct, i);
+        ordatom(cx, name);
+    }
+    k = i;
+
+    for (r=0; r<ROUNDS; r++)
+    {
+        t = nsclock();
+        for (i=0; i<k; i++)
+        {
+            sprintf(name, "B%dX%d", pct, i);
+            ordatom(cx, name);
+        }
+        sum += nsclock()-t;
+        ops += k;
+    }
+    /* the sprintf is part of the timed loop; time it alone and subtract it */
+    t = nsclock();
+    for (r=0; r<ROUNDS; r++)
+        for (i=0; i<k; i++) sprintf(name, "B%dX%d", pct, i);
+    sum -= nsclock()-t;
+    sprintf(what, "ordatom hit, %d%% full", pct);
+    report(what, sum, ops);
+}
+
+void clearmarks(struct Lispctx *cx)
+{
+    int32 i;
+    for (i=1; i<l; i++) unmark(i);
+    for (i=0; i<n; i++) cx->nmark[i] = 0;
+}
+
+void bench_gcmark(struct Lispctx *cx, int16 deep)
+{
+    int32 i, r, k, v;
+    long ops = 0;
+    double t, sum = 0.0;
+
+    resetheap(cx);
+    k = cx->numf/2 - 10;
+    v = cx->nilptr;
+    for (i=0; i<k; i++)
+    {
+        cx->Atab[benchroot].L = v;
+        if (deep)   /* ((((...) . (x)) . (x)) . (x)): gcmark has to recurse into every CAR */
+            v = newloc(cx, v, newloc(cx, cx->nilptr, cx->nilptr));
+        else        /* (x x x ...): gcmark loops down the CDR chain */
+            v = newloc(cx, numatom(cx, 1.0), newloc(cx, cx->nilptr, v));
+    }
+    cx->Atab[benchroot].L = v;
+
+    for (r=0; r<ROUNDS; r++)
+    {
+        t = nsclock();
+        gcmark(cx, v);
+        sum += nsclock()-t;
+        ops += 2*k;
+        clearmarks(cx);
+    }
+    report(deep ? "gcmark deep, per cell" : "gcmark wide, per cell", sum, ops);
+}
+
+void bench_gc(struct Lispctx *cx, int16 pct)
+{
+    int32 i, r, k;
+    double t, sum = 0.0;
+    char what[40];
+
+    resetheap(cx);
+    k = (l-1)*pct/100;
+    for (i=0; i<k; i++)
+        cx->Atab[benchroot].L = newloc(cx, cx->nilptr, cx->Atab[benchroot].L);
+
+    for (r=0; r<ROUNDS; r++)
+    {
+        t = nsclock();
+        gc(cx, GC_CALL);
+        sum += nsclock()-t;
+    }
+    sprintf(what, "gc, %d%% live", pct);
+    report(what, sum, ROUNDS);
+}
+
+void bench_list(struct Lispctx *cx, int16 cmp)
+{
+    int32 i, r, k, t, v;
+    long ops = 0, hits = 0;
+    double tm, sum = 0.0;
+    char what[40];
+
+    resetheap(cx);
+    k = lc*2/3;
+    if (cmp)    /* the list sread, LIST and APPEND make */
+        v = newlist(cx, k);
+    else        /* the list CONS makes */
+        for (v=cx->nilptr, i=0; i<k; i++) v = newloc(cx, cx->nilptr, v);
+    cx->Atab[benchroot].L = v;
+    for (t=v; t != cx->nilptr; t=B(t)) A(t) = cx->tptr;
+
+    for (r=0; r<ROUNDS*10; r++)
+    {
+        tm = nsclock();
+        for (t=v; t != cx->nilptr; t=B(t)) hits += A(t) EQ cx->tptr;
+        sum += nsclock()-tm;
+        ops += k;
+    }
+    sprintf(what, "list walk, %s%s", cmp ? "compact" : "list area", (hits EQ ops)? "" : " (DIFFERS)");
+    report(what, sum, ops);
+
+    for (sum=0.0, r=0; r<ROUNDS; r++)
+    {
+        tm = nsclock();
+        gc(cx, GC_CALL);
+        sum += nsclock()-tm;
+    }
+    sprintf(what, "gc with the list, %s", cmp ? "compact" : "list area");
+    report(what, sum, (long)ROUNDS*k);
+}
+
+void bench_dvector(void)
+{
+    #define DVN 4096
+    static double x[DVN], y[DVN];
+    struct {char *isa; double (*f)(int16, double *, double *, long);} k[3];
+    int16 nk=0, i, op;
+    int32 r;
+    double t, sum, v, v0=0;
+    char what[40];
+
+    for (i=0; i<DVN; i++) {x[i]=sin(i)*1e3; y[i]=cos(i);}
+    k[nk].isa="scalar"; k[nk++].f=dvreduce_c;
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("sse2")) {k[nk].isa="sse2"; k[nk++].f=dvreduce_sse2;}
+    if (__builtin_cpu_supports("avx"))  {k[nk].isa="avx";  k[nk++].f=dvreduce_avx;}
+#endif
+    for (op=DV_SUM; op<=DV_DOT; op+=DV_DOT-DV_SUM)
+        for (i=0; i<nk; i++)
+        {
+            t = nsclock();
+            for (r=0; r<ROUNDS*10; r++) v = k[i].f(op, x, y, DVN);
+            sum = nsclock()-t;
+            if (i EQ 0) v0 = v;
+            sprintf(what, "%s %s%s", (op EQ DV_SUM)? "VSUM" : "VDOT", k[i].isa,
+                    (v EQ v0)? "" : " (DIFFERS)");
+            report(what, sum, (long)ROUNDS*10*DVN);
+        }
+}
+
+int main(void)
+{
+    struct Lispctx *cx;
+
+    cx = newctx();
+    if (setjmp(cx->env))
+    {
+        printf("a benchmark signaled an error\n");
+        return 1;
+    }
+    benchroot = ptrv(ordatom(cx, "benchroot"));
+
+    printf("\nlist area: %d cells, compact list area: %d words, number table: %d, atom table: %d\n", l, lc, n, m);
+    bench_newloc(cx);
+    bench_numatom(cx, 25); bench_numatom(cx, 50); bench_numatom(cx, 75);
+    bench_ordatom(cx, 25); bench_ordatom(cx, 50); bench_ordatom(cx, 75); bench_ordatom(cx, 95);
+    bench_gcmark(cx, 1); bench_gcmark(cx, 0);
+    bench_gc(cx, 0); bench_gc(cx, 50); bench_gc(cx, 90);
+    bench_list(cx, 1); bench_list(cx, 0);
+    bench_dvector();
+    return 0;
+}
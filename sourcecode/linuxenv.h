@@ -18,3 +18,8 @@
 #include <stdarg.h>
 #include <values.h>
 #include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
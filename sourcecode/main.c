@@ -27,10 +27,24 @@
 #define n 1000  /* size of number table */
 #define m 1000  /* size of atom table */
 #define l 6000  /* size of list area */
+#define lc 6000 /* size of the compact list area, in words */
 /* In the book's interpreter code, atom table and number table are
    of equal size, and both thus use n to define their sizes.
    In this version the atom table and number table sizes are separated. */
 
+/* the saved input stream stack structure, see e() */
+struct Insave {struct Insave *link; char *ipg, *ipge; char ig[202]; FILE *ifilep;};
+struct Future;  /* see FUTURE */
+
+/* All the state of one interpreter lives in a struct Lispctx, so that one
+   process can host several independent interpreters, e.g. one per thread.
+   The fields keep the names of the global variables of the book. Every
+   function that uses them takes the context as its first parameter, cx,
+   and passes it on, so a thread works on the context it has been given
+   and nothing else; the macros below that read the list area, like A() and
+   B(), rely on a cx in scope. */
+struct Lispctx {
+
 jmp_buf env;    /* for handling errors, the top-level environment is stored here */
 char *sout;     /* general output buffer pointer, used by swrite of the REPL */
 
@@ -39,8 +53,9 @@ char *sout;     /* general output buffer pointer, used by swrite of the REPL */
     L      - the link to the (global) value of the atom
     bl     - the bind list link for the atom
     plist  - the property list link for the atom
+    pix    - NIL, or a hash table indexing the property list (see GETPROP)
 */
-struct Atomtable {char name[16]; int32 L; int32 bl; int32 plist;} Atab[m];
+struct Atomtable {char name[16]; int32 L; int32 bl; int32 plist; int32 pix; int32 opt; int32 optep;} Atab[m];
 /*
     In essence the interpreter uses shallow binding to resolve the most
     relevant binding for an atom: each atom has its own unique bind list bl,
@@ -87,14 +102,14 @@ int16 nx[n];
 */
 
 /* The number table free space list head pointer; */
-int16 nf = -1;
+int16 nf;
 /* nf holds the index of the first free
    number table node for whenever a new number
    needs to be stored into Ntab.
 */
 
 /* EX 27.8 - nnum: The amount of numbers in the number table */
-int16 nnums = 0;
+int16 nnums;
 /* helps to decide when to gc():
    we want the number table to be close to 80% full
    whenever possible since that will decrease the
@@ -119,24 +134,60 @@ struct Listarea {int32 car; int32 cdr;} *P;
 */
 
 /* the list area free space list head pointer */
-int16 fp = -1;
+int32 fp;
+
+/* The compact list area (see newlist): the node l+i is the word Cw[i], which
+   holds the CAR of the node, and Cc[i] is its CDR-code, which tells its CDR:
+    CC_NEXT - the CDR is the next node, l+i+1
+    CC_NIL  - the CDR is NIL
+    CC_FWD  - Cw[i] is a list area node that holds both the CAR and the CDR
+    CC_FREE - the word is free
+   ctop is where newrun looks for free words next, cnumf counts the free words,
+   and the words from chigh on have all been free since the last collection. */
+int32 *Cw;
+char *Cc;
+int32 ctop, cnumf, chigh;
 
 /* the put-back variable - needed for reading in user input */
-int32 pb = 0;
+int32 pb;
 
 /* the input string and related pointers */
 char *g, *pg, *pge;
 
-/* the input stream stack structure and head pointer */
-struct Insave {struct Insave *link; char *pg, *pge; char g[202]; FILE *filep;};;
+/* the input stream stack head pointer */
 struct Insave *topInsave;
 
 /* the input prompt character */
 char prompt;
 
 /* seval depth count and trace switch -
-   used in traceprint. */
-int16 ct=0, tracesw=0;
+   used in tracerec. */
+int16 ct, tracesw;
+
+/* The trace ring buffer: while tracing is on, seval records a compact binary
+   event on every entry and exit instead of formatting any text. Only the
+   last TRING events are kept; tracedump writes them to a file together with
+   a snapshot of the tables, and the tracedump program decodes that file. */
+#define TRING 65536     /* must be a power of 2 */
+struct Tevent {
+    int64_t t;          /* monotonic clock, nanoseconds */
+    int32   ptr;        /* the typed pointer evaluated or returned */
+    int32   fn;         /* the atom of the function applied at this depth, or -1 */
+    int16   depth;
+    int16   osw;        /* 0 for seval() input, 1 for seval() output */
+} *tring;               /* TRING events, allocated by the first !TRACE */
+long tn, tdumped;       /* events recorded so far, and up to the last dump */
+int32 tfn[256];         /* the function atom of every depth, mod 256 */
+
+/* the profiler switch, set by !PROFILE, and the per-atom call profiles of
+   user-defined functions and special forms (see profbody) */
+int16 profsw;
+struct Profile {long calls; long cells; double incl, excl; int16 active;} Prof[m];
+
+/* the profiler's own stack of active calls, used to compute exclusive times */
+#define PDEPTH 1000
+struct Profframe {int32 a; double t0, child;} pstack[PDEPTH];
+int16 psp;
 
 /* global ordinary atom typed pointers */
 int32 nilptr, tptr, currentin, eaL, quoteptr, sk, traceptr;
@@ -144,15 +195,155 @@ int32 nilptr, tptr, currentin, eaL, quoteptr, sk, traceptr;
 /* number of free list-nodes */
 int32 numf;
 
+/* garbage collector and allocator statistics, reported by GCSTATS and at EXIT */
+#define GC_LIST 0   /* gc() called by newloc: the list area is full */
+#define GC_NUM  1   /* gc() called by numatom: the number table is 80% full */
+#define GC_CALL 2   /* gc() called directly */
+struct Gcstats {
+    long   count[3];    /* collections by trigger */
+    long   allocated;   /* list cells handed out by newloc and newlist, and compact nodes */
+    long   reclaimed;   /* list cells returned to the free list by gc */
+    int32  numflow;     /* low-water mark of numf */
+    int16  nnumspeak;   /* high-water mark of nnums */
+    long   lookups;     /* numatom calls */
+    long   probes;      /* nx slots examined by numatom */
+    int32  probemax;    /* longest numatom probe sequence */
+    int32  natoms;      /* used atom table entries */
+    double pausetot;    /* gc pause times in nanoseconds */
+    double pausemax;
+    double pauselast;
+} gcs;
+
+/* variables used in file operations */
+FILE *filep;
+FILE *logfilep;
+FILE *outfp;    /* where ourprint writes besides the log file, stdout by default */
+
+/* for interpreters embedded in a server or a batch run (see evalall):
+   when embedded is set, the end of the input and EXIT do a longjmp(env, 1)
+   instead of exit(). deadline (on the nsclock) and alloclimit (on
+   gcs.allocated) are checked by seval every LIMITTICKS evaluations, zero
+   means no limit; exceeding one sets aborted and signals an error.
+   inworker is set in the context of a future or a PMAP worker, which has no
+   input and must not leave the thread: there READ, the end of the input and
+   EXIT signal an error, which the caller signals again. */
+int16 embedded, aborted, inworker;
+int32 nerrors;  /* the number of errors signaled so far */
+char errmsg[80];    /* the message of the last one */
+int32 ticks;
+double deadline;
+long alloclimit;
+
+/* the futures this context refers to: a type-2 typed pointer indexes Ftab.
+   v is the value of the future in this context's list area once it has
+   been touched here, -1 before. fmark is the gc mark of the slots. */
+#define NFUT 256
+struct Futslot {struct Future *f; int32 v;} Ftab[NFUT];
+char fmark[NFUT];
+
+/* the vectors (see MAKE-VECTOR): a type-3 typed pointer indexes Vtab, the
+   elements of a vector are the words Vs[base..base+len-1] of the vector
+   store, which gc() compacts. vmark is the gc mark of the Vtab entries. */
+#define NVEC   1000     /* vector headers */
+#define VWORDS 65536    /* words in the vector store */
+#define VK_OBJ 0        /* the kinds of vectors: the elements are typed pointers, */
+#define VK_F64 1        /* or doubles, two words each (see MAKE-DVECTOR), */
+#define VK_BYTES 2      /* or the bytes of strings, four to a word (see STRCAT), */
+#define VK_LIMBS 3      /* or the 32-bit limbs of big integers, one to a word (see PLUS), */
+#define VK_WORDS 4      /* or words that the collector does not look into (see MEMOIZE) */
+struct Vector {int32 base, len; char kind;} Vtab[NVEC];
+int32 *Vs, vtop;        /* the store and its first free word */
+char vmark[NVEC];
+
+/* the hash tables (see MAKE-HASH): a type-4 typed pointer indexes Htab. The
+   key and value pairs are kept in vectors, nv and, while the table is being
+   resized, ov; nv is -1 in a free entry. hmark is the gc mark of Htab. */
+#define NHASH 256
+struct Hashtable {int32 nv, ov, count, used, migr;} Htab[NHASH];
+char hmark[NHASH];
+
+/* the strings: a type-5 typed pointer indexes Stab, the bytes of the string
+   are the len bytes from off on in the VK_BYTES vector buf, which other
+   strings may share; buf is -1 in a free entry. smark is the gc mark. */
+#define NSTR 1000
+struct String {int32 buf, off, len;} Stab[NSTR];
+char smark[NSTR];
+
+/* the big integers: a type-6 typed pointer indexes Btab, the magnitude is the
+   len limbs, least significant first, of the VK_LIMBS vector buf, and neg is
+   its sign; buf is -1 in a free entry. bmark is the gc mark. */
+#define NBIG 1000
+#define IMAX 9007199254740992.0     /* 2^53: the integers up to this are exact as doubles */
+struct Bignum {int32 buf, len; char neg;} Btab[NBIG];
+char bmark[NBIG];
+
+/* the caches of the memoized functions: fn is the atom of the function, or -1
+   in a free entry, and def its definition when it was memoized. The keys and
+   values of the cache are in the VK_OBJ vector kv, the slot table and the LRU
+   links in the VK_WORDS vector ix; see MEMOIZE. nmemo counts the entries in use. */
+#define NMEMO 32
+struct Memo {int32 fn, def, kv, ix, cap, size, count, head, tail;} Mtab[NMEMO];
+int32 nmemo;
+
+/* the hash-consed list nodes: the slots of the table are the words of the
+   VK_WORDS vector hctab, or -1 before the first HCONS; each holds a node or 0.
+   hccount counts the nodes in it. hcread is set by HCONS-READ. */
+int32 hctab, hccount;
+int16 hcread;
+
+/* the definition-time optimizer: optepoch counts the assignments to the atoms
+   of builtins, and to T and NIL, that an optimized body may have relied on;
+   shadowed counts the parameters that hide one of them at the moment, and
+   optpar holds the parameters of the function being optimized (see optdef) */
+int32 optepoch, shadowed, optpar;
+
+/* the other objects: a type-7 typed pointer indexes Otab, and kind tells what
+   the entry is, OK_FREE in a free entry. A promise (see DELAY) holds its
+   expression in a and the bindings it was made under in b until it is forced,
+   and then its value in a. An input (see OPEN-INPUT) holds its file in f, or
+   NULL once it is closed, and the line being read in buf, from offset a to b.
+   omark is the gc mark. */
+#define NOBJ 1000
+#define OK_FREE     0
+#define OK_PROMISE  1
+#define OK_INPUT    2
+struct Object {char kind, forced; int32 a, b; FILE *f; char *buf;} Otab[NOBJ];
+char omark[NOBJ];
+
+/* the input stream that READ-RECORD has taken the place of while it reads
+   the input rdin, or NULL */
+struct Insave *rdsave;
+int32 rdin;
+
+}; /* end of struct Lispctx */
+
+
+#define LIMITTICKS  4096
+
+/* the header of the trace files written by tracedump */
+struct Tracehdr {char magic[8]; int32 natoms, nnum, ncells, nwords, nevents;};
+#define TRACEMAGIC "GOVTRC2"
+
+/* the CDR-codes of the compact list area */
+#define CC_FREE 0
+#define CC_NEXT 1
+#define CC_NIL  2
+#define CC_FWD  3
+
 /* define global macros */
-#define A(j)                P[j].car
-#define B(j)                P[j].cdr
-#define AL(j)               Atab[j].L
-#define Abl(j)              Atab[j].bl
+#define A(j)                (*({int32 j_=(j); (j_ < l)? &cx->P[j_].car : (cx->Cc[j_-l] != CC_FWD)? &cx->Cw[j_-l] : carp(cx, j_);}))    /* the CAR of the node j, compact or not */
+#define B(j)                ({int32 j_=(j); (j_ < l)? cx->P[j_].cdr : (cx->Cc[j_-l] EQ CC_NEXT)? se(j_+1) : cdrof(cx, j_);})        /* the CDR of the node j; setcdr() changes it */
+#define Bl(j)               cx->P[j].cdr    /* the CDR of the list area node j, which is not compact */
+#define compact(j)          ((j) >= l)
+#define AL(j)               cx->Atab[j].L
+#define Abl(j)              cx->Atab[j].bl
+#define Vd(j)               ((double *)&cx->Vs[cx->Vtab[j].base])   /* the elements of a vector of doubles */
+#define Sb(j)               ((char *)&cx->Vs[cx->Vtab[cx->Stab[j].buf].base] + cx->Stab[j].off) /* the bytes of a string */
+#define Bd(j)               ((uint32_t *)&cx->Vs[cx->Vtab[cx->Btab[j].buf].base])    /* the limbs of a big integer */
 
 #define type(f)             (((f)>>28) & 0xf)
-#define ptrv(f)             (0x0fffffff & (f))
-#define sexp(t)             ((t) EQ 0 || (t) EQ 8 || (t) EQ 9)
+#define ptrv(f)             (0x07ffffff & (f))   /* bit 27 is the gc mark bit, see gc() */
+#define sexp(t)             ((t)<10 && (t) != 1)
 #define fctform(t)          ((t)>9)
 #define builtin(t)          ((t) EQ 10 || (t) EQ 11)
 #define userdefd(t)         ((t) EQ 12 || (t) EQ 13)
@@ -160,6 +351,7 @@ int32 numf;
 #define fct(t)              ((t) EQ 10 || (t) EQ 12 || (t) EQ 14)
 #define unnamedfsf(t)       ((t)>13)
 #define namedfsf(t)         ((t)>9 && (t)<14)
+#define hides(j)            (builtin(type(AL(j))) || (j) EQ ptrv(cx->tptr) || (j) EQ ptrv(cx->nilptr))  /* see optdef */
 #define tp(t,j)             ((t) | (j))
 #define ud(j)               (0x10000000 | (j))
 #define se(j)               (0x00000000 | (j))
@@ -184,6 +376,11 @@ int32 numf;
         pointer is pointing at.
         A pointer's type can be one of the following:
         1  - undefined
+        2  - future (see FUTURE)
+        3  - vector (see MAKE-VECTOR)
+        4  - hash table (see MAKE-HASH)
+        5  - string (see STRCAT)
+        6  - big integer (see PLUS)
         8  - variable (ordinary atom)
         9  - number (number atom)
         0  - dotted pair (non-atomic S-expression)
@@ -195,45 +392,203 @@ int32 numf;
         15 - unnamed special form
 */
 
-/* variables used in file operations */
-FILE *filep;
-FILE *logfilep;
-
-int32 seval(int32 i);
-void initlisp(void);
-int32 sread(void);
-void swrite(int32 i);
-void check_arity(int32 p, uint8_t ar, int32 f); /* custom-made, to check the arity of builtin function applications */
-int32 newloc(int32 x, int32 y);
-int32 numatom(double r);
-int32 ordatom(char *s);
-void gc(void);
-void gcmark(int32 p);
-char getgchar(void);
-char lookgchar(void);
-void fillg(void);
-int32 e(void);
-void error(char *s);
+int32 seval(struct Lispctx *cx, int32 i);
+void initlisp(struct Lispctx *cx);
+struct Lispctx *newctx(void);
+void freectx(struct Lispctx *cx);
+struct Lispctx *clonectx(struct Lispctx *src);
+int32 evalall(struct Lispctx *cx, FILE *in);
+void checklimits(struct Lispctx *cx);
+int32 pmap(struct Lispctx *cx, int32 f, int32 lst);
+int32 future(struct Lispctx *cx, int32 x);
+int32 touch(struct Lispctx *cx, int32 v);
+void markobj(struct Lispctx *cx, int32 p);
+void futsweep(struct Lispctx *cx);
+void futretain(struct Lispctx *cx);
+void futdrop(struct Lispctx *cx);
+int32 newvec(struct Lispctx *cx, char kind, int32 len);
+int32 vindex(struct Lispctx *cx, int32 v, int32 x, char *who);
+int32 vcount(struct Lispctx *cx, int32 x, int32 lim, char *who, char *what);
+double *dvec(struct Lispctx *cx, int32 v, char *who);
+int32 dvreduce(struct Lispctx *cx, int16 op, int32 v, int32 w);
+int32 dvmap(struct Lispctx *cx, int16 op, int32 v, int32 w);
+int32 newhash(struct Lispctx *cx, int32 k);
+int32 hashof(struct Lispctx *cx, int32 h, char *who);
+int32 hget(struct Lispctx *cx, int32 h, int32 key);
+void hput(struct Lispctx *cx, int32 h, int32 key, int32 val);
+int16 hrem(struct Lispctx *cx, int32 h, int32 key);
+int32 maphash(struct Lispctx *cx, int32 f, int32 h);
+int32 hashkeys(struct Lispctx *cx, int32 h);
+void hsweep(struct Lispctx *cx);
+int32 apply2(struct Lispctx *cx, int32 f, int32 x, int32 y);
+int32 getprop(struct Lispctx *cx, int32 a, int32 p);
+int32 putprop(struct Lispctx *cx, int32 a, int32 p, int32 v);
+int16 remprop(struct Lispctx *cx, int32 a, int32 p);
+int32 newstr(struct Lispctx *cx, int32 len);
+int32 strof(struct Lispctx *cx, int32 x, char *who);
+int32 readstr(struct Lispctx *cx);
+void writestr(struct Lispctx *cx, int32 j);
+int32 substr(struct Lispctx *cx, int32 x, int32 i, int32 j);
+int32 strcat2(struct Lispctx *cx, int32 x, int32 y);
+int32 strcmp2(struct Lispctx *cx, int32 x, int32 y);
+int32 strsearch(struct Lispctx *cx, int32 x, int32 y);
+int32 strconv(struct Lispctx *cx, int32 x);
+void ssweep(struct Lispctx *cx);
+void numstr(double d, char *b);
+double numval(struct Lispctx *cx, int32 x, char *who);
+int32 arith(struct Lispctx *cx, char op, int32 x, int32 y, char *who);
+int32 sumprod(struct Lispctx *cx, int32 p, int16 prod);
+int16 numcmp(struct Lispctx *cx, int32 x, int32 y, char *who);
+int32 newbig(struct Lispctx *cx, int32 len);
+int32 bigparse(struct Lispctx *cx, char *s, int16 neg);
+char *bigstr(struct Lispctx *cx, int32 j);
+int32 bigneg(struct Lispctx *cx, int32 x);
+void bsweep(struct Lispctx *cx);
+int16 equal(struct Lispctx *cx, int32 x, int32 y);
+int32 memoof(struct Lispctx *cx, int32 a);
+int32 memoize(struct Lispctx *cx, int32 a, int32 cap);
+void memoclear(struct Lispctx *cx, int32 i);
+int32 memoget(struct Lispctx *cx, int32 i, int32 args);
+void memoput(struct Lispctx *cx, int32 i, int32 args, int32 v);
+int32 hcons(struct Lispctx *cx, int32 x, int32 y);
+int32 hshare(struct Lispctx *cx, int32 x);
+int16 hconsed(struct Lispctx *cx, int32 c);
+void hcprune(struct Lispctx *cx);
+int16 optdef(struct Lispctx *cx, int32 a);
+int32 optexpr(struct Lispctx *cx, int32 x);
+int32 codecopy(struct Lispctx *cx, int32 x);
+int16 optparam(struct Lispctx *cx, int32 x);
+int32 delay(struct Lispctx *cx, int32 x);
+int32 force(struct Lispctx *cx, int32 x);
+int32 stream(struct Lispctx *cx, int32 p, int16 take);
+void osweep(struct Lispctx *cx);
+int32 openinput(struct Lispctx *cx, int32 x);
+int32 readrecord(struct Lispctx *cx, int32 h, int32 eof);
+void rdend(struct Lispctx *cx);
+void closeinput(struct Lispctx *cx, int32 i);
+void bindatom(struct Lispctx *cx, int32 t, int32 v);
+void unbindatom(struct Lispctx *cx, int32 t);
+int32 doloop(struct Lispctx *cx, int32 p, int16 list);
+int32 lsort(struct Lispctx *cx, int32 x, int32 pr);
+/* the operations of dvreduce and dvmap */
+#define DV_SUM  0
+#define DV_PROD 1
+#define DV_MIN  2
+#define DV_MAX  3
+#define DV_DOT  4
+#define DV_ADD  5
+#define DV_MUL  6
+void vsweep(struct Lispctx *cx);
+double nsclock(void);
+int serve(char *path, int16 nworkers);
+int serveframes(void);
+int batch(char **files, int nfiles, int16 njobs);
+int32 sread(struct Lispctx *cx);
+void swrite(struct Lispctx *cx, int32 i);
+void check_arity(struct Lispctx *cx, int32 p, uint8_t ar, int32 f); /* custom-made, to check the arity of builtin function applications */
+int32 newloc(struct Lispctx *cx, int32 x, int32 y);
+int32 newrun(struct Lispctx *cx, int32 k);
+int32 newlist(struct Lispctx *cx, int32 k);
+int32 compactcopy(struct Lispctx *cx, int32 x);
+int32 *carp(struct Lispctx *cx, int32 j);
+int32 cdrof(struct Lispctx *cx, int32 j);
+void setcdr(struct Lispctx *cx, int32 j, int32 v);
+int32 numatom(struct Lispctx *cx, double r);
+int32 ordatom(struct Lispctx *cx, char *s);
+void gc(struct Lispctx *cx, int16 why);
+int32 gcstats(struct Lispctx *cx);
+void gcreport(struct Lispctx *cx);
+void heapreport(struct Lispctx *cx);
+void gcmark(struct Lispctx *cx, int32 p);
+char getgchar(struct Lispctx *cx);
+char lookgchar(struct Lispctx *cx);
+void fillg(struct Lispctx *cx);
+int32 e(struct Lispctx *cx);
+void error(struct Lispctx *cx, char *s);
 int16 fgetline(char *s, int16 lim, FILE *stream);
-void ourprint(char *s);
+void ourprint(struct Lispctx *cx, char *s);
+int32 profbody(struct Lispctx *cx, int32 a, int32 b);
+void tracerec(struct Lispctx *cx, int32 v, int16 osw);
+int32 tracedump(struct Lispctx *cx, char *fname);
+void profreport(struct Lispctx *cx);
 
 /* ============================================== */
-void main(void)
+#ifndef GOVOL_NOMAIN
+/* Defining GOVOL_NOMAIN leaves out the REPL, so that the interpreter core can be
+   #included into other programs, like the microbenchmarks in bench.c. */
+
+/* the per-request limits of the evaluation server, see serve(), and of the
+   jobs of a batch run; a negative value means the default of the mode */
+double srvtime=-1;          /* milliseconds */
+long srvcells=-1;           /* list cells allocated in all, freed again or not:
+                               an allocation budget, not a bound on the heap */
+
+int main(int argc, char **argv)
 /*----------------------------------------
-  This is the main rea-eval-print loop
+  This is the main rea-eval-print loop.
+
+  govol --serve PATH [-j N] [-t MS] [-c CELLS]
+  govol --frames [-t MS] [-c CELLS]
+  run the evaluation server instead, see serve().
+  govol --batch [-j N] [-t MS] [-c CELLS] files...
+  evaluates the files in parallel, see batch().
 ------------------------------------------*/
 {
-  initlisp();
-  setjmp(env);
+  int i, k;
+  int16 nworkers=4;
+  char *path=NULL, *mode=NULL;
+  struct Lispctx *cx;
+
+  for (i=1; i<argc; i++)
+  {
+      if (strcmp(argv[i], "--serve") EQ 0 && i+1<argc) {mode=argv[i]; path=argv[++i];}
+      else if (strcmp(argv[i], "--frames") EQ 0) mode=argv[i];
+      else if (strcmp(argv[i], "--batch") EQ 0) mode=argv[i];
+      else if (strcmp(argv[i], "-j") EQ 0 && i+1<argc)
+      {
+          if ((k=atoi(argv[++i])) < 1 || k > 1000)
+          {
+              fprintf(stderr, "govol: -j takes a number of workers from 1 to 1000\n");
+              return 2;
+          }
+          nworkers=k;
+      }
+      else if (strcmp(argv[i], "-t") EQ 0 && i+1<argc) srvtime=atof(argv[++i]);
+      else if (strcmp(argv[i], "-c") EQ 0 && i+1<argc) srvcells=atol(argv[++i]);
+      else if (mode != NULL && strcmp(mode, "--batch") EQ 0 && argv[i][0] != '-') break;
+      else
+      {
+          fprintf(stderr, "usage: govol [--serve PATH [-j N] | --frames | --batch [-j N]] [-t MS] [-c CELLS] [files...]\n");
+          return 2;
+      }
+  }
+  if (mode != NULL && strcmp(mode, "--batch") EQ 0)
+  {   /* batch jobs run without limits unless asked to */
+      if (srvtime < 0) srvtime=0;
+      if (srvcells < 0) srvcells=0;
+      return batch(argv+i, argc-i, nworkers);
+  }
+  if (srvtime < 0) srvtime=10000;
+  if (srvcells < 0) srvcells=10000000;
+  if (mode != NULL && path != NULL) return serve(path, nworkers);
+  if (mode != NULL) return serveframes();
+
+  cx = newctx();
+
+  /* open the logfile */
+  cx->logfilep = fopen("lisp.log", "w");
+  ourprint(cx, "ENTERING THE GOV LISP INTERPRETER\n");
+  setjmp(cx->env);
 
   for (;;) {
-    ourprint("\n");
-    prompt='*';
-    swrite(seval(sread()));
+    ourprint(cx, "\n");
+    cx->prompt='*';
+    swrite(cx, seval(cx, sread(cx)));
   }
 }
+#endif /* GOVOL_NOMAIN */
 
-void error(char *msg)
+void error(struct Lispctx *cx, char *msg)
 /*---------------------------------------------------------------
   Type out the message in the string array msg and do a longjmp()
   to top level afterward to where setjmp was called.
@@ -242,25 +597,34 @@ void error(char *msg)
     int32 i, t;
 
     /* discard all input S-expression and argument list stacks */
-    Atab[currentin].L = nilptr;
-    Atab[eaL].L       = nilptr;
-    Atab[sk].L        = nilptr;
+    cx->Atab[cx->currentin].L = cx->nilptr;
+    cx->Atab[cx->eaL].L       = cx->nilptr;
+    cx->Atab[cx->sk].L        = cx->nilptr;
     /* reset all atoms to their top-level values */
     for (i=0; i<n; i++) {
-        if ((t=Atab[i].bl) != nilptr) {
-            while (t != nilptr) {
-                t = B(t);
-                Atab[i].L = A(t);
-                Atab[i].bl = nilptr;
-            }
+        if ((t=cx->Atab[i].bl) != cx->nilptr) {
+            /* the last node of the bind list holds the top-level value */
+            while (B(t) != cx->nilptr) t = B(t);
+            cx->Atab[i].L = A(t);
+            cx->Atab[i].bl = cx->nilptr;
         }
     }
-
-    ct = 0;
-    ourprint("::");
-    ourprint(msg);
-    ourprint("\n");
-    longjmp(env, -1);
+    cx->shadowed = 0;
+    /* an error in a record puts the input stream of READ-RECORD back */
+    if (cx->rdsave != NULL) rdend(cx);
+
+    /* keep the events that led to the error */
+    if (cx->tn > cx->tdumped) tracedump(cx, "lisp.trace");
+
+    cx->nerrors++;
+    strncpy(cx->errmsg, msg, sizeof(cx->errmsg)-1);
+    cx->ct = 0;
+    cx->psp = 0;
+    for (i=0; i<m; i++) cx->Prof[i].active = 0;
+    ourprint(cx, "::");
+    ourprint(cx, msg);
+    ourprint(cx, "\n");
+    longjmp(cx->env, -1);
 }/*
     For every atom in atom table, there exists a bind list that
     holds all the local bindings of the atom, in the proper order.
@@ -279,21 +643,23 @@ void error(char *msg)
          signal an error and let GC take care of the rest for us...)
 */
 
-void ourprint(char *s) {
+void ourprint(struct Lispctx *cx, char *s) {
 /*---------------------------------------------------------------
 s: the message to be printed out and logged:
 Print the string s in the log file and on the terminal.
 ---------------------------------------------------------------*/
-    printf("%s", s);
-    fprintf(logfilep, "%s", s);
-    fflush(logfilep);
+    fputs(s, cx->outfp);
+    if (cx->logfilep EQ NULL) return;
+    fprintf(cx->logfilep, "%s", s);
+    fflush(cx->logfilep);
 }
 
-void initlisp(void)
+void initlisp(struct Lispctx *cx)
 /*---------------------------------------------------------------
   This procedure installs all built-in functions and special
   forms into the atom table. It also initializes the number table
-  and the list area
+  and the list area. Everything is set up in the context cx,
+  which must have been zeroed (see newctx).
 ---------------------------------------------------------------*/
 {
     int32 i;
@@ -303,38 +669,70 @@ void initlisp(void)
         "LIST", "DO", "COND", "PLUS", "TIMES", "DIFFERENCE", "QUOTIENT", "POWER",
         "FLOOR", "MINUS", "LESSP", "GREATERP", "EVAL", "EQ", "AND", "OR", "SUM",
         "PRODUCT", "PUTPLIST", "GETPLIST", "READ", "PRINT", "PRINTCR", "MKATOM",
-        "BODY", "RPLACA", "RPLACD", "TSETQ", "NULL", "SET", "EXIT"
+        "BODY", "RPLACA", "RPLACD", "TSETQ", "NULL", "SET", "EXIT", "GCSTATS",
+        "PROFILE-REPORT", "TRACE-DUMP", "HEAP-REPORT", "PMAP", "FUTURE", "TOUCH",
+        "MAKE-VECTOR", "VREF", "VSET", "VLENGTH", "LIST-TO-VECTOR", "VECTOR-TO-LIST",
+        "MAKE-DVECTOR", "LIST-TO-DVECTOR", "VSUM", "VPRODUCT", "VMIN", "VMAX", "VDOT",
+        "V+", "V*", "MAKE-HASH", "GETHASH", "PUTHASH", "REMHASH", "HASH-COUNT",
+        "HASH-KEYS", "MAPHASH", "GETPROP", "PUTPROP", "REMPROP", "STRINGP", "STRLEN",
+        "SUBSTR", "STRCAT", "STRCMP", "STRSEARCH", "STRING", "INTERN", "EQUAL", "MEMOIZE",
+        "UNMEMOIZE", "MEMO-CLEAR", "HCONS", "HCONS-READ", "APPEND", "DELAY", "FORCE",
+        "SCONS", "SCAR", "SCDR", "STAKE", "SDROP", "OPEN-INPUT", "READ-RECORD",
+        "CLOSE-INPUT", "WHILE", "DOTIMES", "DOLIST", "APPLY", "FUNCALL", "SORT"
        };
 
     static char BItype[] =
        { 10, 10, 10, 11, 11, 11, 10, 10, 11, 10,
          10, 11, 10, 10, 10, 10, 10, 10, 10, 10,
          10, 10, 10, 11, 11, 10, 10, 10, 10, 10,
-         10, 10, 10, 10, 10, 10, 11, 10, 11, 11
+         10, 10, 10, 10, 10, 10, 11, 10, 11, 11,
+         10, 10, 10, 10, 10, 11, 10, 10, 10, 10,
+         10, 10, 10, 10, 10, 10, 10, 10, 10, 10,
+         10, 10, 10, 10, 10, 10, 10, 10, 10, 10,
+         10, 10, 10, 10, 10, 10, 10, 10, 10, 10,
+         10, 10, 10, 10, 10, 10, 10, 11, 10, 11,
+         10, 10, 10, 10, 10, 10, 10, 11, 11, 11,
+         10, 10, 10
        };
 
     /* number of built-ins in BI[~] and BItype[~] above */
-    #define NBI 40
+    #define NBI 103
 
     /* allocate a global character array for messages: */
-    sout=(char *)calloc(80, sizeof(char));
+    cx->sout=(char *)calloc(80, sizeof(char));
 
     /* allocate the input string */
-    g = (char *)calloc(202, sizeof(char));
-
-    /* allocate the list area */
-    P = (struct Listarea *)calloc(l, sizeof(struct Listarea));
+    cx->g = (char *)calloc(202, sizeof(char));
+
+    /* allocate the list area, and the compact list area, all free */
+    cx->P = (struct Listarea *)calloc(l, sizeof(struct Listarea));
+    cx->Cw = (int32 *)calloc(lc, sizeof(int32));
+    cx->Cc = (char *)calloc(lc, sizeof(char));
+    cx->ctop = cx->chigh = 0;
+    cx->cnumf = lc;
+
+    /* allocate the vector store, all vector headers are free */
+    cx->Vs = (int32 *)calloc(VWORDS, sizeof(int32));
+    cx->vtop = 0;
+    for (i=0; i<NVEC; i++) cx->Vtab[i].len = -1;
+    for (i=0; i<NHASH; i++) cx->Htab[i].nv = -1;
+    for (i=0; i<NSTR; i++) cx->Stab[i].buf = -1;
+    for (i=0; i<NBIG; i++) cx->Btab[i].buf = -1;
+    for (i=0; i<NMEMO; i++) cx->Mtab[i].fn = -1;
+    for (i=0; i<NOBJ; i++) cx->Otab[i].kind = OK_FREE;
+    cx->hctab = -1;
 
     /* initialize atom table names */
     for (i=0; i<m; i++)
-         Atab[i].name[0] = '\0';
+         cx->Atab[i].name[0] = '\0';
 
     /* initialize number table names */
+    cx->nf = -1;
     for (i=0; i<n; i++) {
-         nmark[i] = 0;
-         nx[i] = -1;
-         Ntab[i].nlink = nf;
-         nf = i;
+         cx->nmark[i] = 0;
+         cx->nx[i] = -1;
+         cx->Ntab[i].nlink = cx->nf;
+         cx->nf = i;
     }
 
     /* install typed-case numbers for builtin functions
@@ -354,54 +752,190 @@ void initlisp(void)
        as it appears in BI/BItype-tables.
     -------------------------------------------------*/
     for (i=0; i<NBI; i++) {
-        Atab[ptrv(ordatom(BI[i]))].L = tp((((int32)BItype[i])<<28), (i+1));
+        cx->Atab[ptrv(ordatom(cx, BI[i]))].L = tp((((int32)BItype[i])<<28), (i+1));
     }
 
     /* NIL and T will point to themselves in the atom table,
        the value of QUOTE will be undefined: */
-    nilptr = ordatom("NIL"); Atab[ptrv(nilptr)].L = nilptr;
-    tptr = ordatom("T");     Atab[ptrv(tptr)].L = tptr;
-    quoteptr = ordatom("QUOTE");
+    cx->nilptr = ordatom(cx, "NIL"); cx->Atab[ptrv(cx->nilptr)].L = cx->nilptr;
+    cx->tptr = ordatom(cx, "T");     cx->Atab[ptrv(cx->tptr)].L = cx->tptr;
+    cx->quoteptr = ordatom(cx, "QUOTE");
 
     /* Creating and using the list-valued atoms CURRENTIN, eaL, and sreadlist in the atom
        table is a means to ensure that we protect the list-nodes in these lists during garbage
        collection. We make these atom names lowercased to keep them private.*/
-    currentin = ptrv(ordatom("currentin")); Atab[currentin].L = nilptr;
-    eaL = ptrv(ordatom("eaL"));             Atab[eaL].L = nilptr;
-    sk = ptrv(ordatom("sreadlist"));        Atab[sk].L = nilptr;
+    cx->currentin = ptrv(ordatom(cx, "currentin")); cx->Atab[cx->currentin].L = cx->nilptr;
+    cx->eaL = ptrv(ordatom(cx, "eaL"));             cx->Atab[cx->eaL].L = cx->nilptr;
+    cx->sk = ptrv(ordatom(cx, "sreadlist"));        cx->Atab[cx->sk].L = cx->nilptr;
 
-    #define cilp Atab[currentin].L
-    #define eaLp Atab[eaL].L
-    #define skp  Atab[sk].L
+    #define cilp cx->Atab[cx->currentin].L
+    #define eaLp cx->Atab[cx->eaL].L
+    #define skp  cx->Atab[cx->sk].L
 
     /* initialize the bindlist (bl) and plist fields */
     for (i=0; i<m; i++)
-        Atab[i].bl = Atab[i].plist = nilptr;
-
-    /* set up the list area free space list */
-    for (i=1; i<l; i++) {
-        B(i) = fp;
-        fp = i;
+        cx->Atab[i].bl = cx->Atab[i].plist = cx->Atab[i].pix = cx->Atab[i].opt = cx->nilptr;
+
+    /* set up the list area free space list, in address order (see newlist); it ends
+       in NIL, so that gcmark never follows a CDR out of the list area (see gc) */
+    cx->fp = cx->nilptr;
+    for (i=l-1; i>=1; i--) {
+        Bl(i) = cx->fp;
+        cx->fp = i;
     }
-    numf = l - 1;
+    cx->numf = l - 1;
+    cx->gcs.numflow = cx->numf;
 
-    /* open the logfine */
-    logfilep = fopen("lisp.log", "w");
-    ourprint("ENTERING THE GOV LISP INTERPRETER\n");
+    /* print on the terminal only; main opens the log file */
+    cx->outfp = stdout;
+    cx->logfilep = NULL;
 
     /* establish the input buffer g and the input stream stack topInsave and prepare to read-in
        predefined functions and special forms from the text file lispinit; these should include
        APPEND, REVERSE, EQUAL, APPLY, MEMBER, INTO, ONTO, NOT, ASSOC, NPROC, PUTPROP, GETPROP and
        REMPROP. */
-    topInsave = NULL;
-    strcpy(g, "@lispinit ");
+    cx->topInsave = NULL;
+    strcpy(cx->g, "@lispinit ");
     /* initialize start & end pointers to the string g: */
-    pg = g;
-    pge = g + strlen(g);
-    filep = stdin;
+    cx->pg = cx->g;
+    cx->pge = cx->g + strlen(cx->g);
+    cx->filep = stdin;
+}
+
+struct Lispctx *newctx(void)
+/*---------------------------------------------------------------
+  Allocates a new interpreter context and initializes it with
+  initlisp. Each thread that evaluates in a context must
+  establish its own error recovery point in it first:
+
+      if (setjmp(cx->env) EQ 0) v=seval(cx, sread(cx));
+
+  A context must only be used by one thread at a time.
+---------------------------------------------------------------*/
+{
+    struct Lispctx *cx;
+
+    cx = (struct Lispctx *)calloc(1, sizeof(struct Lispctx));
+    initlisp(cx);
+    return cx;
+}
+
+void freectx(struct Lispctx *cx)
+/*---------------------------------------------------------------
+  Releases the context cx and everything it owns. The input and
+  log files it has opened are closed, stdin is left alone.
+---------------------------------------------------------------*/
+{
+    struct Insave *tb;
+    int32 i;
+
+    while (cx->topInsave != NULL)
+    {
+        tb = cx->topInsave;
+        cx->topInsave = tb->link;
+        if (tb->ifilep != stdin) fclose(tb->ifilep);
+        free(tb);
+    }
+    if (cx->filep != NULL && cx->filep != stdin) fclose(cx->filep);
+    if (cx->logfilep != NULL) fclose(cx->logfilep);
+    for (i=0; i<NOBJ; i++)
+        if (cx->Otab[i].kind EQ OK_INPUT) closeinput(cx, i);
+    futdrop(cx);
+    free(cx->P);
+    free(cx->Cw);
+    free(cx->Cc);
+    free(cx->Vs);
+    free(cx->g);
+    free(cx->sout);
+    free(cx->tring);
+    free(cx);
+}
+
+void *memdup(void *p, size_t k)
+/* returns a malloc'ed copy of the k bytes at p */
+{
+    return memcpy(malloc(k), p, k);
+}
+
+struct Lispctx *clonectx(struct Lispctx *src)
+/*---------------------------------------------------------------
+  Returns a new context that is a copy of src: the same atoms,
+  values, numbers and list cells, so the copy can evaluate
+  anything src can, independently of it. Copying a warmed-up
+  context is much cheaper than initlisp and reading lispinit
+  again. The copy gets no input, log file or trace buffer, and
+  prints on stdout.
+---------------------------------------------------------------*/
+{
+    struct Lispctx *cx;
+    long i, j;
+
+    cx = (struct Lispctx *)memdup(src, sizeof(struct Lispctx));
+    /* the pointer fields still point into src; give cx its own copies */
+    cx->P = (struct Listarea *)memdup(cx->P, l*sizeof(struct Listarea));
+    cx->Cw = (int32 *)memdup(cx->Cw, lc*sizeof(int32));
+    cx->Cc = (char *)memdup(cx->Cc, lc*sizeof(char));
+    cx->Vs = (int32 *)memdup(cx->Vs, VWORDS*sizeof(int32));
+    i = cx->pg-cx->g; j = cx->pge-cx->g;
+    cx->g = (char *)memdup(cx->g, 202);
+    cx->pg = cx->g+i; cx->pge = cx->g+j;
+    cx->sout = (char *)calloc(80, sizeof(char));
+    cx->tring = NULL; cx->tn = cx->tdumped = 0; cx->tracesw = 0;
+    cx->topInsave = NULL;
+    cx->filep = NULL; cx->logfilep = NULL; cx->outfp = stdout;
+    cx->rdsave = NULL;
+    for (i=0; i<NOBJ; i++)  /* the files stay with src, the copies of its inputs are closed */
+        if (cx->Otab[i].kind EQ OK_INPUT) {cx->Otab[i].f=NULL; cx->Otab[i].buf=NULL;}
+    futretain(cx);    /* the copy refers to the same futures */
+    return cx;
 }
 
-int32 sread(void)
+int32 evalall(struct Lispctx *cx, FILE *in)
+/*---------------------------------------------------------------
+  Reads and evaluates every S-expression from in in the current
+  context, printing each result on a line of its own, until the
+  input ends or EXIT is evaluated. An error ends the expression
+  it happened in, like in the REPL, unless a limit was exceeded;
+  that ends the whole input. Returns the number of errors.
+---------------------------------------------------------------*/
+{
+    int32 e0=cx->nerrors;
+
+    /* anything still in g is read first; that is how a new context
+       gets the pending "@lispinit " read in */
+    cx->filep = in;
+    cx->embedded = 1;
+    cx->aborted = 0;
+    cx->ticks = LIMITTICKS;
+    for (;;)
+    {   /* C allows setjmp only as a whole comparison with a constant */
+        if (setjmp(cx->env) EQ 1) break;    /* the end of the input, or EXIT */
+        if (cx->aborted) break;             /* an error after a limit was exceeded */
+        cx->prompt = '*';
+        swrite(cx, seval(cx, sread(cx)));
+        ourprint(cx, "\n");
+    }
+    cx->embedded = 0;
+    return cx->nerrors-e0;
+}
+
+void checklimits(struct Lispctx *cx)
+/* called by seval every LIMITTICKS evaluations */
+{
+    cx->ticks = LIMITTICKS;
+    if (cx->deadline > 0 && nsclock() > cx->deadline)
+    {
+        cx->aborted = 1;
+        error(cx, "time limit exceeded");
+    }
+    if (cx->alloclimit > 0 && cx->gcs.allocated > cx->alloclimit)
+    {
+        cx->aborted = 1;
+        error(cx, "allocation limit exceeded");
+    }
+}
+
+int32 sread(struct Lispctx *cx)
 /*---------------------------------------------------------------------------------------------------------
   This procedure scans an input string g using a lexical token scanning routine, e(), where e() returns
 
@@ -409,9 +943,9 @@ int32 sread(void)
     * 2 if the token is ''' (single quote)
     * 3 if the token is '.'
     * 4 if the token is ')'
-    * or a typed pointer d to an atom or number stored in row ptrv(d) in the atom or number tables. Due
-      to the typecode of d (8 or 9), d is a negative 32-bit integer. The token found by e() is stripped
-      from the front of g.
+    * or a typed pointer d to an atom or number stored in row ptrv(d) in the atom or number tables, or
+      to a string. Due to the typecode of d (8, 9 or 5), d is never 1 to 4. The token found by e() is
+      stripped from the front of g.
 
   sread constructs an S-expression corresponding to the scanned input string and returns a typed-pointer
   to it as its result.
@@ -422,54 +956,63 @@ int32 sread(void)
 {
     int32 j,k,t,c;
 
-    if ((c=e())<= 0) return(c);
+    #define token(c) ((c)>=1 && (c)<=4)   /* e() returns a token, not a typed pointer */
+
+    c=e(cx);
+    if (!token(c)) return(c);
     /* skp is defined as Atab[sk].L */
-    skp=newloc(nilptr, skp); /* push a new node on the skp list. */
-    A(skp)=j=k=newloc(nilptr,nilptr);
+    skp=newloc(cx, cx->nilptr, skp); /* push a new node on the skp list. */
+    A(skp)=j=k=newloc(cx, cx->nilptr,cx->nilptr);
 
     /* we will return k, but we will fill node j first. */
     if (c EQ 1)
     {
-        scan:   A(j)=sread();   /* read in the first element of the list. */
-        next:   if ((c=e())<=2)
+        scan:   A(j)=sread(cx);   /* read in the first element of the list. */
+        next:   c=e(cx);
+                if (!token(c) || c<=2)
                 {
-                    t=newloc(nilptr, nilptr);
-                    B(j)=t;
+                    t=newloc(cx, token(c)? cx->nilptr : c, cx->nilptr);  /* newloc keeps c over a collection */
+                    Bl(j)=t;
                     j=t;
-                    if (c<=0)
+                    if (!token(c))
                     {
                         A(j)=c;
                         goto next;
                     }
-                    pb=c;
+                    cx->pb=c;
                     goto scan;
                 }
 
                 if (c!=4)
                 {
-                    B(j)=sread();
-                    if (e()!=4) error("syntax error");
+                    Bl(j)=sread(cx);
+                    if (e(cx)!=4) error(cx, "syntax error");
                 }
 
+                if (cx->hcread) k=A(skp)=hshare(cx, k);
+                else if (c EQ 4) k=compactcopy(cx, k);  /* a proper list: the nodes read go as garbage */
                 skp=B(skp); /* pop the skp list. */
                 return k;
     }
     if (c EQ 2)
     {
-        A(j)=quoteptr;
-        B(j)=t=newloc(nilptr, nilptr);
-        A(t)=sread();
+        A(j)=cx->quoteptr;
+        Bl(j)=t=newloc(cx, cx->nilptr, cx->nilptr);
+        A(t)=sread(cx);
+        if (cx->hcread) k=A(skp)=hshare(cx, k);
+        else k=compactcopy(cx, k);
         skp=B(skp); /* pop the skp list. */
         return k;
     }
-    error("bad syntax");
+    error(cx, "bad syntax");
 }
 
-int32 e(void)
+int32 e(struct Lispctx *cx)
 {
     double v,f,k,sign;
     int32 t,c;
-    char nc[15], *np;
+    char nc[16], *np;   /* an atom name, as long as Atab[~].name allows */
+    char dg[202], *dp=dg;   /* the digits of an integer, as many as a line of g holds */
     struct Insave *tb;
 
     #define OPENP  '('
@@ -495,42 +1038,48 @@ int32 e(void)
        into a value that the sread recognizes and we
        can just return this value instead of having to
        compute it all over again: */
-    if (pb!=0) {t=pb; pb=0; return(t);}
+    if (cx->pb!=0) {t=cx->pb; cx->pb=0; return(t);}
 
-    start: while ((c=getgchar()) EQ BLANK);  /* remove all the blanks */
+    start: while ((c=getgchar(cx)) EQ BLANK);  /* remove all the blanks */
 
     if (c EQ OPENP)
     {
-        while (lookgchar() EQ BLANK) getgchar();    /* remove all the blanks */
-        if (lookgchar() EQ CLOSEP)
+        while (lookgchar(cx) EQ BLANK) getgchar(cx);    /* remove all the blanks */
+        if (lookgchar(cx) EQ CLOSEP)
         {
-            getgchar();                 // Answer to ex. 27.2: e() is responsible for recognizing NILs
-            return nilptr;              // "()", "( )", "(  )" etc... are NILs and '(' with something other than
+            getgchar(cx);                 // Answer to ex. 27.2: e() is responsible for recognizing NILs
+            return cx->nilptr;              // "()", "( )", "(  )" etc... are NILs and '(' with something other than
         }                               // ')'-character following it is the opening character for a non-NIL list.
         else return 1; // return 1 for the '(' token read.
     }
     if (c EQ EOS)
     {
-        if (topInsave EQ NULL)
+        if (cx->rdsave != NULL) error(cx, "READ-RECORD: the input ends inside a record");
+        if (cx->topInsave EQ NULL)
         {
-            fclose(logfilep);
+            if (cx->inworker) error(cx, "the input ends in a future or PMAP worker");
+            if (cx->embedded) longjmp(cx->env, 1);
+            if (cx->logfilep != NULL) fclose(cx->logfilep);
             exit(0);
         }
         /* restore the previous input stream. */
-        fclose(filep);
-        strcpy(g, topInsave->g);
-        pg=topInsave->pg;
-        pge=topInsave->pge;
-        filep=topInsave->filep;
-        topInsave=topInsave->link;
-        if (prompt EQ '@') prompt='*';
+        fclose(cx->filep);
+        strcpy(cx->g, cx->topInsave->ig);
+        cx->pg=cx->topInsave->ipg;
+        cx->pge=cx->topInsave->ipge;
+        cx->filep=cx->topInsave->ifilep;
+        tb=cx->topInsave;
+        cx->topInsave=cx->topInsave->link;
+        free(tb);
+        if (cx->prompt EQ '@') cx->prompt='*';
         goto start;
     }
     if (c EQ SINGLEQ) return 2;
     if (c EQ CLOSEP)  return 4;
+    if (c EQ '"')     return readstr(cx);
     if (c EQ DOT)
     { /* a DOT can appear either in a decimal number or as the DOTTED-LIST -marker */
-        if (DIGIT(lookgchar()))
+        if (DIGIT(lookgchar(cx)))
         {   /* Handle the decimal number case: */
             sign=1.0;
             v=0.0;
@@ -539,110 +1088,124 @@ int32 e(void)
         return 3;   /* return 3 for a DOTTED-LIST marker */
     }
     if (!(DIGIT(c) || ((c EQ PLUS || c EQ MINUS) &&                  /* if the token is not a number, it must be a symbol */
-                       (DIGIT(lookgchar()) || lookgchar() EQ DOT))))
+                       (DIGIT(lookgchar(cx)) || lookgchar(cx) EQ DOT))))
     {
         np=nc;
         *np++=c;    /* put c in nc[0] */
-        for (c=lookgchar(); c != BLANK && c != DOT && c!= OPENP && c != CLOSEP; c=lookgchar())
-            *np++ = getgchar(); /* add a character to nc */
+        for (c=lookgchar(cx); c != BLANK && c != DOT && c!= OPENP && c != CLOSEP; c=lookgchar(cx))
+        {
+            if (np EQ nc+15) error(cx, "atom name too long");
+            *np++ = getgchar(cx); /* add a character to nc */
+        }
         *np=EOS; /* nc is now a string */
-        if (*nc EQ '@')
-        { /* switch input streams: */
+        if (*nc EQ '@' && cx->rdsave EQ NULL)
+        { /* switch input streams (not in a record, READ-RECORD reads the atom @name): */
             /* first, save the current stream: */
             tb=(struct Insave *)calloc(1, sizeof(struct Insave));
-            tb->link = topInsave;
-            topInsave=tb;
-            strcpy(tb->g, g);
-            tb->pg=pg;
-            tb->pge=pge;
-            tb->filep=filep;
+            tb->link = cx->topInsave;
+            cx->topInsave=tb;
+            strcpy(tb->ig, cx->g);
+            tb->ipg=cx->pg;
+            tb->ipge=cx->pge;
+            tb->ifilep=cx->filep;
 
             /* set up the new input stream: */
-            *g=EOS;
-            pg=pge=g;
-            prompt='@';
-            filep=fopen(nc+1, "r"); /* skip over the @ */
+            *cx->g=EOS;
+            cx->pg=cx->pge=cx->g;
+            cx->prompt='@';
+            cx->filep=fopen(nc+1, "r"); /* skip over the @ */
             goto start;
         }
         /* convert the string nc to upper case */
         for (np=nc; *np!=EOS; np++)
             if (ISLOWER((int16)*np)) *np=(char)TOUPPER((int16)*np);
-        return(ordatom(nc));
+        return(ordatom(cx, nc));
     }
-    if (c EQ MINUS)
+    if (c EQ MINUS || c EQ PLUS)
     {
         v=0.0;
-        sign=-1.0;
+        sign=(c EQ MINUS)? -1.0 : 1.0;
     }
     else
     {
         v=CHVAL(c);
         sign=1.0;
+        *dp++=c;
     }
-    while (DIGIT(lookgchar())) v=10.0*v+CHVAL(getgchar());
-    if (lookgchar() EQ DOT)
+    while (DIGIT(lookgchar(cx)))
     {
-        getgchar();
-        if (DIGIT(lookgchar()))
+        *dp++=lookgchar(cx);
+        v=10.0*v+CHVAL(getgchar(cx));
+    }
+    if (lookgchar(cx) EQ DOT)
+    {
+        getgchar(cx);
+        if (DIGIT(lookgchar(cx)))
         {fraction:
             k=1.0;
             f=0.0;
             do
             {
                 k=10.*k;
-                f=10.*f+CHVAL(getgchar());
-            } while (DIGIT(lookgchar()));
-            v=v+f/k;
+                f=10.*f+CHVAL(getgchar(cx));
+            } while (DIGIT(lookgchar(cx)));
+            return numatom(cx, sign*(v+f/k));
         }
     }
-    return numatom(sign*v);
+    /* an integer that a double may not hold exactly is read digit by digit */
+    if (v >= IMAX)
+    {
+        *dp=EOS;
+        return bigparse(cx, dg, sign<0);
+    }
+    return numatom(cx, sign*v);
 }
 
-char getgchar(void)
+char getgchar(struct Lispctx *cx)
 /* get a character from g. */
 {
-    fillg();
-    return (*pg++);
+    fillg(cx);
+    return (*cx->pg++);
 }
 
-char lookgchar(void)
+char lookgchar(struct Lispctx *cx)
 /* Look at the next character in g, but do not advance. */
 {
-    fillg();
-    return (*pg);
+    fillg(cx);
+    return (*cx->pg);
 }
 
-void fillg(void)
+void fillg(struct Lispctx *cx)
 /* read a line into g[]. A line starting with a "/" is a comment line to be discarded. */
 {
-    while (pg >= pge)
+    while (cx->pg >= cx->pge)
     {
     sprompt:
-        if (filep EQ stdin)
+        if (cx->filep EQ stdin)
         {
-            sprintf(sout, "%c", prompt);
-            ourprint(sout);
+            sprintf(cx->sout, "%c", cx->prompt);
+            ourprint(cx, cx->sout);
         }
 
-        if (fgetline(g, 200, filep)<0)
+        if (cx->filep EQ NULL || fgetline(cx->g, 200, cx->filep)<0)     /* a copy made by clonectx has no input */
         {
-            *g = '\0';
-            pg  = g;
-            pge = g;
+            *cx->g = '\0';
+            cx->pg  = cx->g;
+            cx->pge = cx->g;
             return;
         }
-        if (filep EQ stdin)
+        if (cx->filep EQ stdin && cx->logfilep != NULL)
         {
-            fprintf(logfilep, "%s\n", g);
-            fflush(logfilep);
+            fprintf(cx->logfilep, "%s\n", cx->g);
+            fflush(cx->logfilep);
         }
-        if (*g EQ '/') goto sprompt;
+        if (*cx->g EQ '/') goto sprompt;
 
-        pg=g;
-        pge=g+strlen(g);
-        *pge++=' ';
-        *pge='\0';
-        prompt='>';
+        cx->pg=cx->g;
+        cx->pge=cx->g+strlen(cx->g);
+        *cx->pge++=' ';
+        *cx->pge='\0';
+        cx->prompt='>';
     }
 }
 
@@ -661,11 +1224,13 @@ next line.
 {
     int16 c, i;
     #define TAB 9
+    #define CR  13
 
-    for (i=0; i<lim && (c=fgetc(stream))!=EOF && c!='\n'; i++)
+    for (i=0; i<lim && (c=fgetc(stream))!=EOF && c!='\n'; )
     {
+        if (c EQ CR) continue;  /* drop CRs, the lispinit file has CRLF line ends */
         if (c EQ TAB) c=BLANK;
-        s[i]=c;
+        s[i++]=c;
     }
     s[i]='\0';
 
@@ -675,7 +1240,7 @@ next line.
         return i;
 }
 
-int32 numatom(double r)
+int32 numatom(struct Lispctx *cx, double r)
 /*-------------------------------------------------
 The number r atom is looked up in the number table
 and stored there as a lazy number atom if it is not
@@ -683,7 +1248,7 @@ already present. The typed-pointer to this number
 atom is returned.
 -------------------------------------------------*/
 {
-    int32 c, j;
+    int32 c, j, k=0;
 
     /* The hashnum is calculated from the last 4 bytes of the
        number r, scaled down to 0...n-1, to fit an index in
@@ -696,13 +1261,15 @@ atom is returned.
 	   (80% or more of the maximum size), a new vatiable for
 	   remembering the amount of numbers in the number table
 	   was added to make this possible. */
-	if (nnums >= 0.8*n)
-		gc();
+	if (cx->nnums >= 0.8*n)
+		gc(cx, GC_NUM);
+	cx->gcs.lookups++;
 	/* find either r or the first free index to store r in: */
-	while (nx[j] != -1)
+	while (cx->nx[j] != -1)
 	{
-		if (Ntab[nx[j]].num EQ r) {
-			j = nx[j];
+		k++;    /* count the probes for gcs */
+		if (cx->Ntab[cx->nx[j]].num EQ r) {
+			j = cx->nx[j];
 			goto ret;
 		}
 		else if (++j EQ n) j=0;
@@ -711,21 +1278,25 @@ atom is returned.
 		{ /* The number table is full, the number wasn't found
 		    in the number table and garbage colleciton has already
 		    been performed - signal an error: */
-            error("The number table is full");
+            error(cx, "The number table is full");
 		}
 	}
 
     /* Here nx[j] = -1; get an Ntab node to store a new number in. */
     /* Set up the new Ntab entry: */
-	nnums += 1;
-    nx[j] = nf; // the new node will be stored in Ntab[nf]
-    j = nf;
-    nf = Ntab[nf].nlink; // set nf to point to the next free number.
-    Ntab[j].num = r;
-ret: return(nu(j));
+	cx->nnums += 1;
+	if (cx->nnums > cx->gcs.nnumspeak) cx->gcs.nnumspeak = cx->nnums;
+    cx->nx[j] = cx->nf; // the new node will be stored in Ntab[nf]
+    j = cx->nf;
+    cx->nf = cx->Ntab[cx->nf].nlink; // set nf to point to the next free number.
+    cx->Ntab[j].num = r;
+ret:
+    cx->gcs.probes += k;
+    if (k > cx->gcs.probemax) cx->gcs.probemax = k;
+    return(nu(j));
 }
 
-int32 ordatom(char *s)
+int32 ordatom(struct Lispctx *cx, char *s)
 /*-------------------------------------------------
 The ordinary atom whose name is given as the
 argument string s is looked up in the atom table
@@ -741,20 +1312,21 @@ this ordinary atom is then returned.
     #define hashname(s) (labs((s[0]<<16)+(s[(j=strlen(s))-1]<<8)+j) % m)
     c=j=hashname(s);
 
-    while (Atab[j].name[0] != EOS) {
-        if (strcmp(Atab[j].name, s) EQ 0) goto ret;
+    while (cx->Atab[j].name[0] != EOS) {
+        if (strcmp(cx->Atab[j].name, s) EQ 0) goto ret;
         else if (++j EQ n)
             j = 0;
 
-        if (j EQ c) error("atom table is full");
+        if (j EQ c) error(cx, "atom table is full");
     }
 
-    strcpy(Atab[j].name, s);
-    Atab[j].L = ud(j);
+    strcpy(cx->Atab[j].name, s);
+    cx->Atab[j].L = ud(j);
+    cx->gcs.natoms++;
 ret: return(oa(j));
 }
 
-void swrite(int32 j)
+void swrite(struct Lispctx *cx, int32 j)
 /*-------------------------------------------------
   swrite handles the PRINT-phase of the GOVOL LISP
   READ-EVAL-PRINT loop.
@@ -762,6 +1334,7 @@ void swrite(int32 j)
 {
     int32 i;
     int16 listsw;
+    char *s;
 
     i=ptrv(j);
     switch(type(j))
@@ -769,73 +1342,223 @@ void swrite(int32 j)
         case 0: /* check for a list */
             j=i;
             while (type(B(j)) EQ 0) j=B(j);
-            listsw=(B(j) EQ nilptr);
-            ourprint("(");
+            listsw=(B(j) EQ cx->nilptr);
+            ourprint(cx, "(");
             while (listsw)
             {
-                swrite(A(i));
-                if ((i=B(i)) EQ nilptr) goto close; else ourprint(" ");
+                swrite(cx, A(i));
+                if ((i=B(i)) EQ cx->nilptr) goto close; else ourprint(cx, " ");
             }
-            swrite(A(i)); ourprint(" . "); swrite(B(i));
-close:      ourprint(")");
+            swrite(cx, A(i)); ourprint(cx, " . "); swrite(cx, B(i));
+close:      ourprint(cx, ")");
             break;
 
-        case  8: ourprint(Atab[i].name); break;
-        case  9: sprintf(sout, "%-g", Ntab[i].num); ourprint(sout); break;
-        case 10: sprintf(sout, "{builtin function: %s}", Atab[i].name);
-                 ourprint(sout); break;
-        case 11: sprintf(sout, "{builtin special form: %s}", Atab[i].name);
-                 ourprint(sout); break;
-        case 12: sprintf(sout, "{user define function: %s}", Atab[i].name);
-                 ourprint(sout); break;
-        case 13: sprintf(sout, "{user defined special form: %s}", Atab[i].name);
-                 ourprint(sout); break;
-        case 14: ourprint("{unnamed function}"); break;
-        case 15: ourprint("{unnamed special form}"); break;
+        case  8: ourprint(cx, cx->Atab[i].name); break;
+        case  9: numstr(cx->Ntab[i].num, cx->sout); ourprint(cx, cx->sout); break;
+        case 10: sprintf(cx->sout, "{builtin function: %s}", cx->Atab[i].name);
+                 ourprint(cx, cx->sout); break;
+        case 11: sprintf(cx->sout, "{builtin special form: %s}", cx->Atab[i].name);
+                 ourprint(cx, cx->sout); break;
+        case 12: sprintf(cx->sout, "{user define function: %s}", cx->Atab[i].name);
+                 ourprint(cx, cx->sout); break;
+        case 13: sprintf(cx->sout, "{user defined special form: %s}", cx->Atab[i].name);
+                 ourprint(cx, cx->sout); break;
+        case 14: ourprint(cx, "{unnamed function}"); break;
+        case 15: ourprint(cx, "{unnamed special form}"); break;
+        case  2: /* a future prints as its value once it has been touched */
+                 if (cx->Ftab[i].f != NULL && cx->Ftab[i].v != -1) swrite(cx, cx->Ftab[i].v);
+                 else ourprint(cx, "{future}");
+                 break;
+        case  3: /* a vector prints as #(x0 x1 ...), a vector of doubles as #D(x0 x1 ...) */
+                 if (cx->Vs EQ NULL) {ourprint(cx, "#(...)"); break;}  /* not in a trace dump */
+                 ourprint(cx, (cx->Vtab[i].kind EQ VK_F64)? "#D(" : "#(");
+                 for (j=0; j<cx->Vtab[i].len; j++)
+                 {
+                     if (j>0) ourprint(cx, " ");
+                     if (cx->Vtab[i].kind EQ VK_OBJ) swrite(cx, cx->Vs[cx->Vtab[i].base+j]);
+                     else {sprintf(cx->sout, "%-g", Vd(i)[j]); ourprint(cx, cx->sout);}
+                 }
+                 ourprint(cx, ")");
+                 break;
+        case  4: sprintf(cx->sout, "{hash table: %d entries}", cx->Htab[i].count);
+                 ourprint(cx, cx->sout); break;
+        case  5: if (cx->Vs EQ NULL) ourprint(cx, "\"...\"");  /* not in a trace dump */
+                 else writestr(cx, i);
+                 break;
+        case  6: if (cx->Vs EQ NULL) {ourprint(cx, "{big integer}"); break;}
+                 s=bigstr(cx, i);
+                 ourprint(cx, s);
+                 free(s);
+                 break;
+        case  7: /* a promise prints as {promise}, or as {promise: value} once it has been forced */
+                 if (cx->Otab[i].kind EQ OK_INPUT) ourprint(cx, (cx->Otab[i].f EQ NULL)? "{closed input}" : "{input}");
+                 else if (cx->Otab[i].forced) {ourprint(cx, "{promise: "); swrite(cx, cx->Otab[i].a); ourprint(cx, "}");}
+                 else ourprint(cx, "{promise}");
+                 break;
     }
     /* There's naturally no need for case 1 check, because seval would have already
        signaled an error if we tried to print the value of an undefined variable. */
 }
 
 
-void traceprint(int32 v, int16 osw)
+double nsclock(void)
+/* the monotonic clock in nanoseconds */
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec*1e9 + t.tv_nsec;
+}
+
+void tracerec(struct Lispctx *cx, int32 v, int16 osw)
 /*-------------------------------------------------
-  v: the object to be printed
+  v: the object to be recorded
   osw: 1 for seval() output, 0 for seval() input
   ----------------------------------------------
-  This function prints out the input and the result
-  for each successive invocation of seval() when
-    tracing is requested.
+  Records the input or the result of an seval()
+  invocation in the trace ring buffer. Called only
+  when tracing is requested.
+-------------------------------------------------*/
+{
+    struct Tevent *ev=&cx->tring[cx->tn++ & (TRING-1)];
+
+    if (osw EQ 0)
+        cx->tfn[++cx->ct & 255]=(type(v) EQ 0 && type(A(v)) EQ 8)? ptrv(A(v)) : -1;
+    ev->t=(int64_t)nsclock();
+    ev->ptr=v;
+    ev->fn=cx->tfn[cx->ct & 255];
+    ev->depth=cx->ct;
+    ev->osw=osw;
+    if (osw EQ 1) cx->ct--;
+}
+
+int32 tracedump(struct Lispctx *cx, char *fname)
+/*-------------------------------------------------
+  Writes the events in the trace ring buffer, the
+  oldest first, into the file fname. The atom
+  table, the number table and the list area are
+  written before them, so that the tracedump
+  program can print the recorded typed pointers.
+  Returns the number of events written.
+-------------------------------------------------*/
+{
+    struct Tracehdr h;
+    FILE *f;
+    long i, first;
+
+    first=(cx->tn > TRING)? cx->tn-TRING : 0;
+    strcpy(h.magic, TRACEMAGIC);
+    h.natoms=m; h.nnum=n; h.ncells=l; h.nwords=lc; h.nevents=cx->tn-first;
+
+    if ((f=fopen(fname, "wb")) EQ NULL) return 0;
+    fwrite(&h, sizeof(h), 1, f);
+    fwrite(cx->Atab, sizeof(struct Atomtable), m, f);
+    fwrite(cx->Ntab, sizeof(union Numbertabe), n, f);
+    fwrite(cx->P, sizeof(struct Listarea), l, f);
+    fwrite(cx->Cw, sizeof(int32), lc, f);
+    fwrite(cx->Cc, sizeof(char), lc, f);
+    for (i=first; i<cx->tn; i++)
+        fwrite(&cx->tring[i & (TRING-1)], sizeof(struct Tevent), 1, f);
+    fclose(f);
+    cx->tdumped=cx->tn;
+    return h.nevents;
+}
+
+int32 profbody(struct Lispctx *cx, int32 a, int32 b)
+/*-------------------------------------------------
+  a: the atom of the user-defined function or
+     special form being applied
+  b: the body to be evaluated
+  ----------------------------------------------
+  Evaluates b like seval does, and charges the
+  call, its time and the list cells allocated
+  during it to Prof[a]. The time spent in other
+  profiled calls made from b is subtracted from
+  the exclusive time of a. Inclusive figures of
+  recursive functions are only charged by the
+  outermost activation, so they are not counted
+  twice.
 -------------------------------------------------*/
 {
-    if (tracesw > 0)
+    int32 v;
+    int16 sp;
+    long c0;
+    double t;
+
+    if (cx->psp EQ PDEPTH) return seval(cx, b); /* too deep to profile, charge it to the caller */
+    sp=cx->psp++;
+    cx->pstack[sp].a=a;
+    cx->pstack[sp].child=0.0;
+    cx->Prof[a].active++;
+    c0=cx->gcs.allocated;
+    cx->pstack[sp].t0=nsclock();
+
+    v=seval(cx, b);
+
+    t=nsclock()-cx->pstack[sp].t0;
+    cx->psp=sp;
+    cx->Prof[a].calls++;
+    cx->Prof[a].excl += t-cx->pstack[sp].child;
+    if (--cx->Prof[a].active EQ 0)
     {
-        if (osw EQ 1)
-            sprintf(sout, "%d result:", ct--);
-        else
-            sprintf(sout, "%d eval:", ++ct);
+        cx->Prof[a].incl += t;
+        cx->Prof[a].cells += cx->gcs.allocated-c0;
+    }
+    if (sp>0) cx->pstack[sp-1].child += t;
+    return v;
+}
+
+int profcmp(const void *x, const void *y)
+/* order profiles by decreasing exclusive time */
+{
+    double d=(*(struct Profile **)y)->excl - (*(struct Profile **)x)->excl;
+    return (d>0)? 1 : (d<0)? -1 : 0;
+}
+
+void profreport(struct Lispctx *cx)
+/*-------------------------------------------------
+  Prints the call profiles collected since the
+  profiler was first switched on, the most
+  expensive functions (by exclusive time) first.
+-------------------------------------------------*/
+{
+    int32 i, k;
+    struct Profile *pr[m];
+
+    for (k=i=0; i<m; i++)
+        if (cx->Prof[i].calls>0) pr[k++]=&cx->Prof[i];
+    qsort(pr, k, sizeof(struct Profile *), profcmp);
+
+    sprintf(cx->sout, "\n%-16s %10s %12s %12s %10s\n", "FUNCTION", "CALLS", "INCL-MS", "EXCL-MS", "CELLS");
+    ourprint(cx, cx->sout);
+    for (i=0; i<k; i++)
+    {
+        sprintf(cx->sout, "%-16s %10ld %12.3f %12.3f %10ld\n", cx->Atab[pr[i]-cx->Prof].name, pr[i]->calls,
+                pr[i]->incl/1e6, pr[i]->excl/1e6, pr[i]->cells);
+        ourprint(cx, cx->sout);
     }
 }
 
-int32 seval(int32 p)
+int32 seval(struct Lispctx *cx, int32 p)
 /*-------------------------------------------------
 Evaluate the S-expression pointed to by the
 typed-pointer p; construct the result value as
 necessary; return a typed-pointer to the result.
 -------------------------------------------------*/
 {
-    int32 ty, t, v, f, fa, na, ar_ef;
+    int32 ty, t, v, f, fa, na, ar_ef, pa, mi, body, old, ap;
+    int16 ea, uk;
     int32 *endeaL;
-    static int32 j;
-    static double s;
+    int32 j;
+    double s;
 
     #define U1 A(p)
     #define U2 A(B(p))
     #define E1 A(p)
     #define E2 A(B(p))
-    #define Return(v) {traceprint(v,1); return(v);}
+    #define Return(v) {if (cx->tracesw>0) tracerec(cx, v,1); return(v);}
 
-    traceprint(p, 0);
+    if (cx->tracesw>0) tracerec(cx, p, 0);
+    if (--cx->ticks < 0) checklimits(cx);
 
     if (type(p)!=0)
     { /* p does not point to a non-atomic S-expression.
@@ -860,36 +1583,47 @@ necessary; return a typed-pointer to the result.
         /* The association list is implemented with shallow binding in the atom table, so  the current
            values of all atoms are found in the atom table. */
 
-        if (Atab[j].name[0] EQ '!')
-        {   /* "!TRACE" sets the traces, "![anything else]" unsets it. Afterwards, the control will be
-               directed back at the top of evaluation. */
-            tracesw=(strcmp(Atab[j].name, "!TRACE") EQ 0)? 1 : 0;
-            longjmp(env, -1);
+        if (cx->Atab[j].name[0] EQ '!')
+        {   /* "!TRACE" sets the traces, "!PROFILE" sets the profiler, "![anything else]" unsets both.
+               Afterwards, the control will be directed back at the top of evaluation. */
+            if (strcmp(cx->Atab[j].name, "!TRACE") EQ 0)
+            {
+                if (cx->tring EQ NULL) cx->tring=(struct Tevent *)calloc(TRING, sizeof(struct Tevent));
+                cx->tracesw=1;
+            }
+            else if (strcmp(cx->Atab[j].name, "!PROFILE") EQ 0) cx->profsw=1;
+            else cx->tracesw=cx->profsw=0;
+            longjmp(cx->env, -1);
         }
 
-        if ((t=type(Atab[j].L)) EQ 1)
+        if ((t=type(cx->Atab[j].L)) EQ 1)
         {   /* The capture of undefined variables: */
-            sprintf(sout, "%s is undefined\n", Atab[j].name);
-            error(sout);
+            sprintf(cx->sout, "%s is undefined\n", cx->Atab[j].name);
+            error(cx, cx->sout);
         }
 
         if (namedfsf(t)) Return(tp(t<<28, j));
 
-        return Atab[j].L;
+        Return(cx->Atab[j].L);
     } /* end of if (type(p)!=0) */
 
     /* save the list p consisting of the current function and the supplied arguments as the top
        value of the currentin list of lists to protect it from garbage collection. The current list
        is a list of lists. (cilp is defined as Atab[currentin].L) */
-    cilp=newloc(p, cilp);
+    cilp=newloc(cx, p, cilp);
 
     /* compute the function or special form to be applied: */
-    tracesw--;
+    cx->tracesw--;
     ar_ef=A(p); /* get the builtin function's or special form's atom into ar_ef for arity checking */
-    f=seval(A(p)); tracesw++; ty=type(f);
-    if (!fctform(ty)) error(" invalid function or special form");
-    f=ptrv(f);
-    if (!unnamedfsf(ty)) f=ptrv(Atab[f].L);
+    f=seval(cx, A(p)); cx->tracesw++; ty=type(f);
+    if (!fctform(ty)) error(cx, " invalid function or special form");
+    /* a builtin put in place of its atom by the optimizer is still the atom's value (see optdef) */
+    if (builtin(ty) && type(cx->Atab[ptrv(f)].L) != ty) error(cx, " invalid function or special form");
+    ea=fct(ty);     /* the frame to pop is on eaL, even if APPLY goes on with a special form */
+    pa=f=ptrv(f);   /* keep the function's atom for the profiler */
+    if (!unnamedfsf(ty)) f=ptrv(cx->Atab[f].L);
+    else skp=newloc(cx, tp(ty<<28, f), skp);    /* nothing else keeps the node LAMBDA made */
+    uk=unnamedfsf(ty);
 
     /* now let go of the supplied input function */
     A(cilp)=p=B(p);
@@ -900,15 +1634,19 @@ necessary; return a typed-pointer to the result.
     if (fct(ty))
     { /* Compute the actual arguments */
       /* First, make room for the values of the arguments in eaL: */
-        eaLp=newloc(nilptr, eaLp);
+        eaLp=newloc(cx, cx->nilptr, eaLp);
       /* Then, evaluate the actual arguments and build a list by tail-consing: */
         endeaL=&A(eaLp);
-        while (p != nilptr)
+        while (p != cx->nilptr)
         {
-            /* Evaluate an argument and reserve a new cell to the end of eaL for it. */
-            *endeaL=newloc(seval(A(p)), nilptr);
+            /* Evaluate an argument and reserve a new cell to the end of eaL for it.
+               Builtin functions get the values of futures, except CONS and LIST,
+               which can build structures of futures without waiting for them. */
+            t=seval(cx, A(p));
+            if (type(t) EQ 2 && ty EQ 10 && f != 3 && f != 10) t=touch(cx, t);
+            *endeaL=newloc(cx, t, cx->nilptr);
              /* update the end of eaL to point to the end of the newly allocated cell. */
-             endeaL=&B(*endeaL);
+             endeaL=&Bl(*endeaL);
              /* move on to the next argument: */
              p=B(p);
 
@@ -934,108 +1672,137 @@ necessary; return a typed-pointer to the result.
     }
 
     /* At this point p points to the first node of the actual argument list. If p EQ nilptr, we have a
-       function or special form with no arguments. */
-
+       function or special form with no arguments. APPLY and FUNCALL come back here with theirs. */
+dispatch:
     if (!builtin(ty))
     { /* f is a non-builtin function/special form. Do shallow binding of
-         the arguments and evaluate the body of f by calling seval. */
+         the arguments and evaluate the body of f by calling seval. A memoized
+         function first looks for the arguments in its cache. */
+        mi=-1;
+        ap=p;
+        if (cx->nmemo && ty EQ 12 && (mi=memoof(cx, pa)) >= 0 && (v=memoget(cx, mi, p)) != -1) goto done;
+        /* A function defined with SETQ has an optimized body, which is used unless
+           a parameter hides a builtin at the moment; it is made again if a builtin
+           it relied on has been assigned to since, and dropped if the function has
+           been defined again (see optdef). */
+        body=B(f);
+        if (userdefd(ty) && cx->Atab[pa].opt != cx->nilptr)
+        {
+            if (A(cx->Atab[pa].opt) != cx->Atab[pa].L) cx->Atab[pa].opt=cx->nilptr;
+            else if (cx->shadowed EQ 0 && (cx->Atab[pa].optep EQ cx->optepoch || optdef(cx, pa))) body=B(cx->Atab[pa].opt);
+        }
          fa = A(f); /* fa points to the first node of the formal argument list */
          na = 0;    /* na counts the number of arguments */
 
       /* run through the arguments and place them as the top values of the formal argument atoms in the
          atom table. Push the old value of each formal argument on its binding list. */
-        if (type(fa) EQ 8 && fa!=nilptr)
+        if (type(fa) EQ 8 && fa!=cx->nilptr)
         { /* deal with a function/special form of the form (DEF* f lst-param (...)): */
             t=ptrv(fa);
-            Atab[t].bl=newloc(Atab[t].L, Atab[t].bl);
-            Atab[t].L=p;
+            if (hides(t)) cx->shadowed++;
+            cx->Atab[t].bl=newloc(cx, cx->Atab[t].L, cx->Atab[t].bl);
+            cx->Atab[t].L=p;
             goto apply;
         }
         else
         {   /* deal with a function/special form of the form (DEF* f (param1 param2 ...) (...)): */
-            while (p!=nilptr && dottedpair(type(fa)))
+            while (p!=cx->nilptr && dottedpair(type(fa)))
             {
                 t=ptrv(A(fa));
                 fa=B(fa);
-                Atab[t].bl=newloc(Atab[t].L, Atab[t].bl);
+                if (hides(t)) cx->shadowed++;
+                cx->Atab[t].bl=newloc(cx, cx->Atab[t].L, cx->Atab[t].bl);
                 v=A(p);
                 if (namedfsf(type(v)))
-                    v=Atab[ptrv(v)].L;  /* get the pointer to the actual builtin or userdefined function/special form */
-                Atab[t].L=v;
+                    v=cx->Atab[ptrv(v)].L;  /* get the pointer to the actual builtin or userdefined function/special form */
+                cx->Atab[t].L=v;
                 ++na;
                 p=B(p);
             }
 
-            if (p!=nilptr)
-                error("too many actual arguments");
+            if (p!=cx->nilptr)
+                error(cx, "too many actual arguments");
             /* The following code would forbid some useful trickery.
             else if(fa!=nilptr) error("too few actual arguments"); */
         }
 
-        /* Now apply the non-builtin special form or function */
-apply:  v=seval(B(f));
+        /* Now apply the non-builtin special form or function. When the profiler is off,
+           this test is all it costs. Unnamed functions have no atom to be profiled under. */
+apply:  if (cx->profsw && userdefd(ty)) v=profbody(cx, pa, body);
+        else v=seval(cx, body);
 
         /* Next, unbind the parameter variables. */
         /* first, reset fa to point at the beginning of the f's parameter list: */
         fa=A(f);
-        if (type(fa) EQ 8 && fa != nilptr)
+        if (type(fa) EQ 8 && fa != cx->nilptr)
         { /* handle the unbinding of a (DEF* f lst-param (...)) form: */
             t = ptrv(fa);
-            Atab[t].L = A(Atab[t].bl);
-            Atab[t].bl = B(Atab[t].bl);
+            cx->Atab[t].L = A(cx->Atab[t].bl);
+            cx->Atab[t].bl = B(cx->Atab[t].bl);
+            if (hides(t)) cx->shadowed--;
         }
         else
         { /* handle the unbinding of a (DEF* f (param1 param2 ...) (...)) form: */
             while (na-->0)
             {
                 t = ptrv(A(fa));
-                Atab[t].L = A(Atab[t].bl);
-                Atab[t].bl = B(Atab[t].bl);
+                cx->Atab[t].L = A(cx->Atab[t].bl);
+                cx->Atab[t].bl = B(cx->Atab[t].bl);
+                if (hides(t)) cx->shadowed--;
                 fa = B(fa);
             }
         }
+        /* the argument list is still kept by eaL */
+        if (mi >= 0) memoput(cx, mi, ap, v);
     } /* end non-builtins */
     else
     { /* At this point we have a builtin function or special form. f is the pointer value of the
          atom in the atom table for the called function or special form and p is the pointer to
          the argument list. */
-        v=nilptr;
+        v=cx->nilptr;
         switch (f)
         {
             case 1:     /* CAR */
-                    check_arity(p, 1, ar_ef);
-                    if (!dottedpair(type(E1))) error("Illegal CAR argument");
+                    check_arity(cx, p, 1, ar_ef);
+                    if (!dottedpair(type(E1))) error(cx, "Illegal CAR argument");
                     v=A(E1);
                     break;
             case 2:     /* CDR */
-                    check_arity(p, 1, ar_ef);
-                    if (!dottedpair(type(E1))) error("Illegal CDR argument");
+                    check_arity(cx, p, 1, ar_ef);
+                    if (!dottedpair(type(E1))) error(cx, "Illegal CDR argument");
                     v=B(E1);
                     break;
             case 3:     /* CONS */
-                    check_arity(p, 2, ar_ef);
-                    if (sexp(type(E1)) && sexp(type(E2))) v=newloc(E1, E2);
-                    else error("Illegal CONS arguments");
+                    check_arity(cx, p, 2, ar_ef);
+                    if (sexp(type(E1)) && sexp(type(E2))) v=newloc(cx, E1, E2);
+                    else error(cx, "Illegal CONS arguments");
                     break;
 
             /* for LAMBDA and SPECIAL, we could check that U1 is either an ordinary atom
                or a list of ordinary atoms. */
             case 4:     /* LAMBDA */
-                    check_arity(p, 2, ar_ef);
-                    v=tf(newloc(U1,U2));
+                    check_arity(cx, p, 2, ar_ef);
+                    v=tf(newloc(cx, codecopy(cx, U1),U2));  /* the parameters are bound at every call */
                     break;
             case 5:     /* SPECIAL */
-                    check_arity(p, 2, ar_ef);
-                    v=ts(newloc(U1,U2));
+                    check_arity(cx, p, 2, ar_ef);
+                    v=ts(newloc(cx, codecopy(cx, U1),U2));
                     break;
             case 6:     /* SETQ */
-                    check_arity(p, 2, ar_ef);
-                    f=U1; if (!(type(f) EQ 8)) error("illegal assignment");
+                    check_arity(cx, p, 2, ar_ef);
+                    f=U1; if (!(type(f) EQ 8)) error(cx, "illegal assignment");
                     assign: v=ptrv(f); endeaL=&AL(v);
-                    doit: t=seval(U2);
+                    doit: t=seval(cx, U2);
+                    old=*endeaL;
                     switch (type(t))
                     {
                         case 0:  /* dotted pair */
+                        case 2:  /* future */
+                        case 3:  /* vector */
+                        case 4:  /* hash table */
+                        case 5:  /* string */
+                        case 6:  /* big integer */
+                        case 7:  /* promise */
                         case 8:  /* ordinary atom */
                         case 9:  /* number atom */
                                  *endeaL=t; break;
@@ -1049,9 +1816,14 @@ apply:  v=seval(B(f));
                         case 15: /* unnamed special form */
                                  *endeaL=us(ptrv(t)); break;
                     } /* end of type(t) switch cases */
-                    tracesw--;
-                    v=seval(f);
-                    tracesw++;
+                    if (builtin(type(old)) || builtin(type(*endeaL))
+                        || endeaL EQ &AL(ptrv(cx->tptr)) || endeaL EQ &AL(ptrv(cx->nilptr)))
+                        cx->optepoch++;     /* the optimized bodies may rely on the old value */
+                    if (userdefd(type(*endeaL)) && type(f) EQ 8 && endeaL EQ &AL(ptrv(f)))
+                        optdef(cx, ptrv(f));
+                    cx->tracesw--;
+                    v=seval(cx, f);
+                    cx->tracesw++;
                     break;
 
                     /* Ex. 27.15:
@@ -1062,17 +1834,17 @@ apply:  v=seval(B(f));
 
 
             case 7:     /* ATOM */
-                    check_arity(p, 1, ar_ef);
-                    if ((type(E1)) EQ 8 || (type(E1)) EQ 9)
-                        v=tptr;
+                    check_arity(cx, p, 1, ar_ef);
+                    if ((type(E1)) EQ 8 || (type(E1)) EQ 9 || (type(E1)) EQ 6)
+                        v=cx->tptr;
                     break;
             case 8:     /* NUMBERP */
-                    check_arity(p, 1, ar_ef);
-                    if ((type(E1)) EQ 9)
-                        v=tptr;
+                    check_arity(cx, p, 1, ar_ef);
+                    if ((type(E1)) EQ 9 || (type(E1)) EQ 6)
+                        v=cx->tptr;
                     break;
             case 9:     /* QUOTE */
-                    check_arity(p, 1, ar_ef);
+                    check_arity(cx, p, 1, ar_ef);
                     v = U1;
                     break;
             case 10:     /* LIST */
@@ -1096,17 +1868,18 @@ apply:  v=seval(B(f));
                              and it would be reset at the top level, once the evaluation of an
                              expression has finished.
                            */
+                    v=compactcopy(cx, v);   /* the list of arguments goes as garbage */
                     break;
             case 11:     /* DO */
-                    while (p!=nilptr) {v=A(p); p=B(p);}
+                    while (p!=cx->nilptr) {v=A(p); p=B(p);}
                     break;
             case 12:     /* COND */
-                    while (p!=nilptr)
+                    while (p!=cx->nilptr)
                     {
                         t=A(p);
-                        if (seval(A(t))!=nilptr)
+                        if (touch(cx, seval(cx, A(t)))!=cx->nilptr)
                         {
-                            v=seval(A(B(t)));
+                            v=seval(cx, A(B(t)));
                             break;
                         }
                         else
@@ -1114,160 +1887,528 @@ apply:  v=seval(B(f));
                     }
                     break;
             case 13:     /* PLUS */
-                    check_arity(p, 2, ar_ef);
-                    v=numatom(Ntab[ptrv(E1)].num + Ntab[ptrv(E2)].num);
+                    check_arity(cx, p, 2, ar_ef);
+                    v=arith(cx, '+', E1, E2, "PLUS");
                     break;
             case 14:     /* TIMES */
-                    check_arity(p, 2, ar_ef);
-                    v=numatom(Ntab[ptrv(E1)].num * Ntab[ptrv(E2)].num);
+                    check_arity(cx, p, 2, ar_ef);
+                    v=arith(cx, '*', E1, E2, "TIMES");
                     break;
             case 15:     /* DIFFERENCE */
-                    check_arity(p, 2, ar_ef);
-                    v=numatom(Ntab[ptrv(E1)].num - Ntab[ptrv(E2)].num);
+                    check_arity(cx, p, 2, ar_ef);
+                    v=arith(cx, '-', E1, E2, "DIFFERENCE");
                     break;
             case 16:     /* QUOTIENT */
-                    check_arity(p, 2, ar_ef);
-                    v=numatom(Ntab[ptrv(E1)].num / Ntab[ptrv(E2)].num);
+                    check_arity(cx, p, 2, ar_ef);
+                    v=arith(cx, '/', E1, E2, "QUOTIENT");
                     break;
             case 17:     /* POWER */
-                    check_arity(p, 2, ar_ef);
-                    v=numatom(pow(Ntab[ptrv(E1)].num, Ntab[ptrv(E2)].num));
+                    check_arity(cx, p, 2, ar_ef);
+                    v=numatom(cx, pow(numval(cx, E1, "POWER"), numval(cx, E2, "POWER")));
                     break;
             case 18:     /* FLOOR */
-                    check_arity(p, 1, ar_ef);
-                    v=numatom(floor(Ntab[ptrv(E1)].num));
+                    check_arity(cx, p, 1, ar_ef);
+                    v=(type(E1) EQ 6)? E1 : numatom(cx, floor(numval(cx, E1, "FLOOR")));
                     break;
             case 19:     /* MINUS */
-                    check_arity(p, 1, ar_ef);
-                    v=numatom(-Ntab[ptrv(E1)].num);
+                    check_arity(cx, p, 1, ar_ef);
+                    v=(type(E1) EQ 6)? bigneg(cx, E1) : numatom(cx, -numval(cx, E1, "MINUS"));
                     break;
             case 20:     /* LESSP */
-                    check_arity(p, 2, ar_ef);
-                    if(Ntab[ptrv(E1)].num < Ntab[ptrv(E2)].num) v=tptr;
+                    check_arity(cx, p, 2, ar_ef);
+                    if (numcmp(cx, E1, E2, "LESSP") < 0) v=cx->tptr;
                     break;
             case 21:     /* GREATERP */
-                    check_arity(p, 2, ar_ef);
-                    if(Ntab[ptrv(E1)].num > Ntab[ptrv(E2)].num) v=tptr;
+                    check_arity(cx, p, 2, ar_ef);
+                    if (numcmp(cx, E1, E2, "GREATERP") > 0) v=cx->tptr;
                     break;
             case 22:     /* EVAL */
-                    check_arity(p, 1, ar_ef);
-                    v=seval(U1);
+                    check_arity(cx, p, 1, ar_ef);
+                    v=seval(cx, U1);
                     break;
             case 23:     /* EQ */
-                    check_arity(p, 2, ar_ef);
-                    v=(E1 EQ E2)? tptr: nilptr;
+                    check_arity(cx, p, 2, ar_ef);
+                    v=(E1 EQ E2 || (type(E1) EQ 6 && type(E2) EQ 6 && numcmp(cx, E1, E2, "EQ") EQ 0))? cx->tptr: cx->nilptr;
                     break;
             case 24:     /* AND */
-                    while (p!=nilptr && seval(A(p))!=nilptr) p=B(p);
-                    if (p EQ nilptr) v=tptr;
+                    while (p!=cx->nilptr && touch(cx, seval(cx, A(p)))!=cx->nilptr) p=B(p);
+                    if (p EQ cx->nilptr) v=cx->tptr;
                     break;
             case 25:     /* OR */
-                    while (p!=nilptr && seval(A(p))==nilptr) p=B(p);
-                    if (p!=nilptr) v=tptr;
+                    while (p!=cx->nilptr && touch(cx, seval(cx, A(p)))==cx->nilptr) p=B(p);
+                    if (p!=cx->nilptr) v=cx->tptr;
                     break;
             case 26:     /* SUM */
-                    for(s=0.0; p!=nilptr; p=B(p))
-                    {
-                        v=A(p);
-                        if (type(v)!= 9) error("SUM application: trying to sum a non-number value");
-                        s += Ntab[ptrv(v)].num;
-                    }
-                    v=numatom(s);
-                    break;
             case 27:     /* PRODUCT */
-                for(s=1.0; p!=nilptr; p=B(p))
-                    {
-                        v=A(p);
-                        if (type(v)!= 9) error("SUM application: trying to sum a non-number value");
-                        s *= Ntab[ptrv(v)].num;
-                    }
-                    v=numatom(s);
+                    v=sumprod(cx, p, f EQ 27);
                     break;
             case 28:     /* PUTPLIST */
-                    check_arity(p, 2, ar_ef);
+                    check_arity(cx, p, 2, ar_ef);
 
                     v=E1;
                     if (type(v)!=8) /* signal an error if A(p) is not an atom */
-                        error("PUTPLIST application: the first argument is not an atom");
+                        error(cx, "PUTPLIST application: the first argument is not an atom");
                     /* TODO: check whether E2 is a proper property list... */
-                    Atab[ptrv(v)].plist=E2;
+                    cx->Atab[ptrv(v)].plist=E2;
+                    cx->Atab[ptrv(v)].pix=cx->nilptr;   /* GETPROP rebuilds the index when needed */
                     break;
             case 29:     /* GETPLIST */
-                    check_arity(p, 1, ar_ef);
+                    check_arity(cx, p, 1, ar_ef);
                     v=E1;
                     if (type(v)!=8) /* signal an error if A(p) is not an atom */
-                        error("GETPLIST application: the first argument is not an atom");
-                    v=Atab[ptrv(v)].plist;
+                        error(cx, "GETPLIST application: the first argument is not an atom");
+                    v=cx->Atab[ptrv(v)].plist;
                     break;
             case 30:     /* READ */
-                    ourprint("n>"); prompt=EOS; v=sread();
+                    if (cx->inworker) error(cx, "READ: no input in a future or PMAP worker");
+                    ourprint(cx, "n>"); cx->prompt=EOS; v=sread(cx);
                     break;
             case 31:     /* PRINT */
-                    if (p EQ nilptr) ourprint(" ");
-                    else while (p!=nilptr) {swrite(A(p)); ourprint(" "); p=B(p);}
+                    if (p EQ cx->nilptr) ourprint(cx, " ");
+                    else while (p!=cx->nilptr) {swrite(cx, A(p)); ourprint(cx, " "); p=B(p);}
                     break;
             case 32:     /* PRINTCR */
-                    if (p EQ nilptr) ourprint("\n");
-                    else while (p!=nilptr) {swrite(A(p)); ourprint("\n"); p=B(p);}
+                    if (p EQ cx->nilptr) ourprint(cx, "\n");
+                    else while (p!=cx->nilptr) {swrite(cx, A(p)); ourprint(cx, "\n"); p=B(p);}
                     break;
             case 33:     /* MKATOM */
-                    check_arity(p, 2, ar_ef);
-                    strcpy(sout, Atab[ptrv(E1)].name); strcat(sout, Atab[ptrv(E2)].name);
-                    v=ordatom(sout);
+                    check_arity(cx, p, 2, ar_ef);
+                    strcpy(cx->sout, cx->Atab[ptrv(E1)].name); strcat(cx->sout, cx->Atab[ptrv(E2)].name);
+                    v=ordatom(cx, cx->sout);
                     break;
             case 34:     /* BODY */
-                    check_arity(p, 1, ar_ef);
+                    check_arity(cx, p, 1, ar_ef);
                     if (unnamedfsf(type(E1))) v=ptrv(E1); /*ptrv(E1) EQ se(ptrv(E1)), which is the pointer value of E1 appended with the type 'dottedpair' (type 0).*/
-                    else if (userdefd(type(E1))) v=ptrv(Atab[ptrv(E1)].L);
-                    else error("BODY application: Illegal argument");
+                    else if (userdefd(type(E1))) v=ptrv(cx->Atab[ptrv(E1)].L);
+                    else error(cx, "BODY application: Illegal argument");
                     break;
             case 35:     /* RPLACA */
-                    check_arity(p, 2, ar_ef);
+                    check_arity(cx, p, 2, ar_ef);
                     v=E1;
-                    if (!dottedpair(type(v))) error("illegal RPLACA argument");
+                    if (!dottedpair(type(v))) error(cx, "illegal RPLACA argument");
                     A(v) = E2;
                     break;
             case 36:     /* RPLACD */
-                    check_arity(p, 2, ar_ef);
+                    check_arity(cx, p, 2, ar_ef);
                     v=E1;
-                    if (!dottedpair(type(v))) error("illegal RPLACD argument");
-                    B(v) = E2;
+                    if (!dottedpair(type(v))) error(cx, "illegal RPLACD argument");
+                    setcdr(cx, v, E2);
                     break;
             case 37:     /* TSETQ */
-                    check_arity(p, 2, ar_ef);
+                    check_arity(cx, p, 2, ar_ef);
                     f=U1;
-                    if (type(f)!=8) error("TSETQ application: first argument given is not an atom");
+                    if (type(f)!=8) error(cx, "TSETQ application: first argument given is not an atom");
                     f=ptrv(f);
-                    if (Abl(f) EQ nilptr) goto assign;
-                    v=Abl(f); while (B(v)!=nilptr) v=B(v);
+                    if (Abl(f) EQ cx->nilptr) goto assign;
+                    v=Abl(f); while (B(v)!=cx->nilptr) v=B(v);
                     endeaL=&A(v); goto doit;
 
             case 38:     /* NULL */
-                    check_arity(p, 1, ar_ef);
-                    if (E1 EQ nilptr) v=tptr;
+                    check_arity(cx, p, 1, ar_ef);
+                    if (E1 EQ cx->nilptr) v=cx->tptr;
                     break;
             case 39:     /* SET */
-                    check_arity(p, 2, ar_ef);
-                    f=seval(U1);
-                    if (type(f)!=8) error("SET application: evaluated first argument is not an atom");
+                    check_arity(cx, p, 2, ar_ef);
+                    f=seval(cx, U1);
+                    if (type(f)!=8) error(cx, "SET application: evaluated first argument is not an atom");
                     goto assign;
                     break;
             case 40:    /* EXIT */
-                    check_arity(p, 0, ar_ef);
+                    check_arity(cx, p, 0, ar_ef);
+                    if (cx->inworker) error(cx, "EXIT: not in a future or PMAP worker");
+                    if (cx->embedded) longjmp(cx->env, 1);
+                    gcreport(cx);
                     exit(0);
                     break;
+            case 41:    /* GCSTATS */
+                    check_arity(cx, p, 0, ar_ef);
+                    v=gcstats(cx);
+                    break;
+            case 42:    /* PROFILE-REPORT */
+                    check_arity(cx, p, 0, ar_ef);
+                    profreport(cx);
+                    break;
+            case 43:    /* TRACE-DUMP */
+                    check_arity(cx, p, 0, ar_ef);
+                    v=numatom(cx, tracedump(cx, "lisp.trace"));
+                    break;
+            case 44:    /* HEAP-REPORT */
+                    check_arity(cx, p, 0, ar_ef);
+                    heapreport(cx);
+                    break;
+            case 45:    /* PMAP */
+                    check_arity(cx, p, 2, ar_ef);
+                    if (!fct(type(E1))) error(cx, "PMAP application: the first argument is not a function");
+                    v=pmap(cx, E1, E2);
+                    break;
+            case 46:    /* FUTURE */
+                    check_arity(cx, p, 1, ar_ef);
+                    v=future(cx, U1);
+                    break;
+            case 47:    /* TOUCH */
+                    check_arity(cx, p, 1, ar_ef);
+                    v=E1;   /* a future argument has been touched above */
+                    break;
+            case 48:    /* MAKE-VECTOR */
+                    if (p EQ cx->nilptr || (B(p) != cx->nilptr && B(B(p)) != cx->nilptr))
+                        error(cx, "MAKE-VECTOR application: one or two arguments expected");
+                    t=vcount(cx, E1, VWORDS, "MAKE-VECTOR", "length");
+                    v=newvec(cx, VK_OBJ, t);
+                    f=(B(p) EQ cx->nilptr)? cx->nilptr : E2;
+                    for (j=0; j<t; j++) cx->Vs[cx->Vtab[ptrv(v)].base+j]=f;
+                    break;
+            case 49:    /* VREF */
+                    check_arity(cx, p, 2, ar_ef);
+                    j=vindex(cx, E1, E2, "VREF");
+                    if (cx->Vtab[ptrv(E1)].kind EQ VK_F64) v=numatom(cx, Vd(ptrv(E1))[j]);
+                    else v=cx->Vs[cx->Vtab[ptrv(E1)].base+j];
+                    break;
+            case 50:    /* VSET */
+                    check_arity(cx, p, 3, ar_ef);
+                    j=vindex(cx, E1, E2, "VSET");
+                    v=A(B(B(p)));
+                    if (cx->Vtab[ptrv(E1)].kind EQ VK_OBJ) cx->Vs[cx->Vtab[ptrv(E1)].base+j]=v;
+                    else if (type(v) EQ 9) Vd(ptrv(E1))[j]=cx->Ntab[ptrv(v)].num;
+                    else error(cx, "VSET application: a vector of doubles only holds numbers");
+                    break;
+            case 51:    /* VLENGTH */
+                    check_arity(cx, p, 1, ar_ef);
+                    if (type(E1) != 3) error(cx, "VLENGTH application: the argument is not a vector");
+                    v=numatom(cx, cx->Vtab[ptrv(E1)].len);
+                    break;
+            case 52:    /* LIST-TO-VECTOR */
+                    check_arity(cx, p, 1, ar_ef);
+                    for (t=0, f=E1; dottedpair(type(f)); f=B(f)) t++;
+                    v=newvec(cx, VK_OBJ, t);
+                    for (j=0, f=E1; j<t; j++, f=B(f)) cx->Vs[cx->Vtab[ptrv(v)].base+j]=A(f);
+                    break;
+            case 53:    /* VECTOR-TO-LIST */
+                    check_arity(cx, p, 1, ar_ef);
+                    if (type(E1) != 3) error(cx, "VECTOR-TO-LIST application: the argument is not a vector");
+                    /* cons up the list from the back; newloc protects its arguments,
+                       and the element is fetched before newloc may move the vector */
+                    if (cx->Vtab[ptrv(E1)].kind EQ VK_OBJ)
+                        for (j=cx->Vtab[ptrv(E1)].len-1; j>=0; j--)
+                            v=newloc(cx, cx->Vs[cx->Vtab[ptrv(E1)].base+j], v);
+                    else
+                    {   /* numatom does not protect the list built so far */
+                        skp=newloc(cx, cx->nilptr, skp);
+                        for (j=cx->Vtab[ptrv(E1)].len-1; j>=0; j--)
+                            A(skp)=newloc(cx, numatom(cx, Vd(ptrv(E1))[j]), A(skp));
+                        v=A(skp);
+                        skp=B(skp);
+                    }
+                    break;
+            case 54:    /* MAKE-DVECTOR */
+                    if (p EQ cx->nilptr || (B(p) != cx->nilptr && B(B(p)) != cx->nilptr))
+                        error(cx, "MAKE-DVECTOR application: one or two arguments expected");
+                    t=vcount(cx, E1, VWORDS, "MAKE-DVECTOR", "length");
+                    if (B(p) EQ cx->nilptr) s=0.0;
+                    else if (type(E2) EQ 9) s=cx->Ntab[ptrv(E2)].num;
+                    else error(cx, "MAKE-DVECTOR application: the initial element is not a number");
+                    v=newvec(cx, VK_F64, t);
+                    for (j=0; j<t; j++) Vd(ptrv(v))[j]=s;
+                    break;
+            case 55:    /* LIST-TO-DVECTOR */
+                    check_arity(cx, p, 1, ar_ef);
+                    for (t=0, f=E1; dottedpair(type(f)); f=B(f), t++)
+                        if (type(A(f)) != 9) error(cx, "LIST-TO-DVECTOR application: a list element is not a number");
+                    v=newvec(cx, VK_F64, t);
+                    for (j=0, f=E1; j<t; j++, f=B(f)) Vd(ptrv(v))[j]=cx->Ntab[ptrv(A(f))].num;
+                    break;
+            case 56:    /* VSUM */
+                    check_arity(cx, p, 1, ar_ef);
+                    v=dvreduce(cx, DV_SUM, E1, cx->nilptr);
+                    break;
+            case 57:    /* VPRODUCT */
+                    check_arity(cx, p, 1, ar_ef);
+                    v=dvreduce(cx, DV_PROD, E1, cx->nilptr);
+                    break;
+            case 58:    /* VMIN */
+                    check_arity(cx, p, 1, ar_ef);
+                    v=dvreduce(cx, DV_MIN, E1, cx->nilptr);
+                    break;
+            case 59:    /* VMAX */
+                    check_arity(cx, p, 1, ar_ef);
+                    v=dvreduce(cx, DV_MAX, E1, cx->nilptr);
+                    break;
+            case 60:    /* VDOT */
+                    check_arity(cx, p, 2, ar_ef);
+                    v=dvreduce(cx, DV_DOT, E1, E2);
+                    break;
+            case 61:    /* V+ */
+                    check_arity(cx, p, 2, ar_ef);
+                    v=dvmap(cx, DV_ADD, E1, E2);
+                    break;
+            case 62:    /* V* */
+                    check_arity(cx, p, 2, ar_ef);
+                    v=dvmap(cx, DV_MUL, E1, E2);
+                    break;
+            case 63:    /* MAKE-HASH */
+                    if (p EQ cx->nilptr) v=newhash(cx, 0);
+                    else
+                    {
+                        check_arity(cx, p, 1, ar_ef);
+                        v=newhash(cx, vcount(cx, E1, VWORDS, "MAKE-HASH", "size"));
+                    }
+                    break;
+            case 64:    /* GETHASH */
+                    check_arity(cx, p, 2, ar_ef);
+                    v=hget(cx, hashof(cx, E1, "GETHASH"), E2);
+                    if (v EQ -1) v=cx->nilptr;
+                    break;
+            case 65:    /* PUTHASH */
+                    check_arity(cx, p, 3, ar_ef);
+                    v=A(B(B(p)));
+                    hput(cx, hashof(cx, E1, "PUTHASH"), E2, v);
+                    break;
+            case 66:    /* REMHASH */
+                    check_arity(cx, p, 2, ar_ef);
+                    if (hrem(cx, hashof(cx, E1, "REMHASH"), E2)) v=cx->tptr;
+                    break;
+            case 67:    /* HASH-COUNT */
+                    check_arity(cx, p, 1, ar_ef);
+                    v=numatom(cx, cx->Htab[hashof(cx, E1, "HASH-COUNT")].count);
+                    break;
+            case 68:    /* HASH-KEYS */
+                    check_arity(cx, p, 1, ar_ef);
+                    v=hashkeys(cx, hashof(cx, E1, "HASH-KEYS"));
+                    break;
+            case 69:    /* MAPHASH */
+                    check_arity(cx, p, 2, ar_ef);
+                    if (!fct(type(E1))) error(cx, "MAPHASH application: the first argument is not a function");
+                    v=maphash(cx, E1, hashof(cx, E2, "MAPHASH"));
+                    break;
+            case 70:    /* GETPROP */
+                    check_arity(cx, p, 2, ar_ef);
+                    if (type(E1) != 8) error(cx, "GETPROP application: the first argument is not an atom");
+                    v=getprop(cx, ptrv(E1), E2);
+                    if (v EQ -1) v=cx->nilptr; else v=B(v);
+                    break;
+            case 71:    /* PUTPROP */
+                    check_arity(cx, p, 3, ar_ef);
+                    if (type(E1) != 8) error(cx, "PUTPROP application: the first argument is not an atom");
+                    v=putprop(cx, ptrv(E1), E2, A(B(B(p))));
+                    break;
+            case 72:    /* REMPROP */
+                    check_arity(cx, p, 2, ar_ef);
+                    if (type(E1) != 8) error(cx, "REMPROP application: the first argument is not an atom");
+                    if (remprop(cx, ptrv(E1), E2)) v=cx->tptr;
+                    break;
+            case 73:    /* STRINGP */
+                    check_arity(cx, p, 1, ar_ef);
+                    if (type(E1) EQ 5) v=cx->tptr;
+                    break;
+            case 74:    /* STRLEN */
+                    check_arity(cx, p, 1, ar_ef);
+                    v=numatom(cx, cx->Stab[strof(cx, E1, "STRLEN")].len);
+                    break;
+            case 75:    /* SUBSTR */
+                    if (p EQ cx->nilptr || B(p) EQ cx->nilptr || (B(B(p)) != cx->nilptr && B(B(B(p))) != cx->nilptr))
+                        error(cx, "SUBSTR application: two or three arguments expected");
+                    t=cx->Stab[strof(cx, E1, "SUBSTR")].len;
+                    f=(B(B(p)) EQ cx->nilptr)? numatom(cx, t) : A(B(B(p)));
+                    v=substr(cx, E1, vcount(cx, E2, t, "SUBSTR", "index"), vcount(cx, f, t, "SUBSTR", "index"));
+                    break;
+            case 76:    /* STRCAT */
+                    check_arity(cx, p, 2, ar_ef);
+                    v=strcat2(cx, E1, E2);
+                    break;
+            case 77:    /* STRCMP */
+                    check_arity(cx, p, 2, ar_ef);
+                    v=numatom(cx, strcmp2(cx, E1, E2));
+                    break;
+            case 78:    /* STRSEARCH */
+                    check_arity(cx, p, 2, ar_ef);
+                    t=strsearch(cx, E1, E2);
+                    v=(t<0)? cx->nilptr : numatom(cx, t);
+                    break;
+            case 79:    /* STRING */
+                    check_arity(cx, p, 1, ar_ef);
+                    v=strconv(cx, E1);
+                    break;
+            case 80:    /* INTERN */
+                    check_arity(cx, p, 1, ar_ef);
+                    t=strof(cx, E1, "INTERN");
+                    if (cx->Stab[t].len EQ 0 || cx->Stab[t].len > 15) error(cx, "INTERN application: illegal atom name length");
+                    memcpy(cx->sout, Sb(t), cx->Stab[t].len);
+                    cx->sout[cx->Stab[t].len]=EOS;
+                    v=ordatom(cx, cx->sout);
+                    break;
+            case 81:    /* EQUAL */
+                    check_arity(cx, p, 2, ar_ef);
+                    if (equal(cx, E1, E2)) v=cx->tptr;
+                    break;
+            case 82:    /* MEMOIZE */
+                    if (p EQ cx->nilptr || (B(p) != cx->nilptr && B(B(p)) != cx->nilptr))
+                        error(cx, "MEMOIZE application: one or two arguments expected");
+                    if (type(E1) != 12) error(cx, "MEMOIZE application: a named user-defined function expected");
+                    t=1024;
+                    if (B(p) != cx->nilptr)
+                    {
+                        if (type(E2) != 9 || cx->Ntab[ptrv(E2)].num < 1 || cx->Ntab[ptrv(E2)].num > 8192)
+                            error(cx, "MEMOIZE application: the size must be 1 to 8192");
+                        t=(int32)cx->Ntab[ptrv(E2)].num;
+                    }
+                    memoize(cx, ptrv(E1), t);
+                    v=E1;
+                    break;
+            case 83:    /* UNMEMOIZE */
+                    check_arity(cx, p, 1, ar_ef);
+                    if (type(E1) EQ 12 && (t=memoof(cx, ptrv(E1))) >= 0)
+                    {
+                        cx->Mtab[t].fn=-1;      /* the cache goes with the next collection */
+                        cx->nmemo--;
+                    }
+                    v=E1;
+                    break;
+            case 84:    /* MEMO-CLEAR */
+                    check_arity(cx, p, 1, ar_ef);
+                    if (type(E1) EQ 12 && (t=memoof(cx, ptrv(E1))) >= 0) memoclear(cx, t);
+                    v=E1;
+                    break;
+            case 85:    /* HCONS */
+                    check_arity(cx, p, 2, ar_ef);
+                    if (sexp(type(E1)) && sexp(type(E2))) v=hcons(cx, E1, E2);
+                    else error(cx, "Illegal HCONS arguments");
+                    break;
+            case 86:    /* HCONS-READ */
+                    check_arity(cx, p, 1, ar_ef);
+                    v=cx->hcread? cx->tptr : cx->nilptr;
+                    cx->hcread=(E1 != cx->nilptr);
+                    break;
+            case 87:    /* APPEND */
+                    check_arity(cx, p, 2, ar_ef);
+                    /* a compact copy of the nodes of E1 (see newlist), and then E2; a
+                       non-NIL atom at the end of E1 is an element of its own, like in (CONS X Y) */
+                    for (t=0, j=E1; dottedpair(type(j)); j=B(j)) t++;
+                    if (j != cx->nilptr) t++;
+                    if (t EQ 0) {v=E2; break;}
+                    v=newlist(cx, t);
+                    for (t=v, j=E1; dottedpair(type(j)); j=B(j))
+                    {
+                        A(t)=A(j);
+                        if (B(t) != cx->nilptr) t=B(t);
+                    }
+                    if (j != cx->nilptr) A(t)=j;
+                    if (E2 != cx->nilptr)
+                    {   /* this splits the last node of a compact copy, and a collection
+                           there would see only that node: the run before it is kept on skp */
+                        skp=newloc(cx, v, skp);
+                        setcdr(cx, t, E2);
+                        skp=B(skp);
+                    }
+                    break;
+            case 88:    /* DELAY */
+                    check_arity(cx, p, 1, ar_ef);
+                    v=delay(cx, U1);
+                    break;
+            case 89:    /* FORCE */
+                    check_arity(cx, p, 1, ar_ef);
+                    v=force(cx, E1);
+                    break;
+            case 90:    /* SCONS */
+                    check_arity(cx, p, 2, ar_ef);
+                    t=seval(cx, U1);
+                    if (!sexp(type(t))) error(cx, "Illegal SCONS arguments");
+                    skp=newloc(cx, t, skp);
+                    v=newloc(cx, t, delay(cx, U2));
+                    skp=B(skp);
+                    break;
+            case 91:    /* SCAR */
+                    check_arity(cx, p, 1, ar_ef);
+                    if (!dottedpair(type(E1))) error(cx, "Illegal SCAR argument");
+                    v=A(E1);
+                    break;
+            case 92:    /* SCDR */
+                    check_arity(cx, p, 1, ar_ef);
+                    if (!dottedpair(type(E1))) error(cx, "Illegal SCDR argument");
+                    v=force(cx, B(E1));
+                    break;
+            case 93:    /* STAKE */
+                    check_arity(cx, p, 2, ar_ef);
+                    v=stream(cx, p, 1);
+                    break;
+            case 94:    /* SDROP */
+                    check_arity(cx, p, 2, ar_ef);
+                    v=stream(cx, p, 0);
+                    break;
+            case 95:    /* OPEN-INPUT */
+                    check_arity(cx, p, 1, ar_ef);
+                    v=openinput(cx, E1);
+                    break;
+            case 96:    /* READ-RECORD */
+                    if (p EQ cx->nilptr || (B(p) != cx->nilptr && B(B(p)) != cx->nilptr))
+                        error(cx, "READ-RECORD application: one or two arguments expected");
+                    v=readrecord(cx, E1, (B(p) EQ cx->nilptr)? cx->nilptr : E2);
+                    break;
+            case 97:    /* CLOSE-INPUT */
+                    check_arity(cx, p, 1, ar_ef);
+                    if (type(E1) != 7 || cx->Otab[ptrv(E1)].kind != OK_INPUT)
+                        error(cx, "CLOSE-INPUT application: an input expected");
+                    closeinput(cx, ptrv(E1));
+                    break;
+            case 98:    /* WHILE */
+                    if (p EQ cx->nilptr) error(cx, "WHILE application: a test expected");
+                    while (touch(cx, seval(cx, A(p))) != cx->nilptr)
+                        for (t=B(p); t != cx->nilptr; t=B(t)) seval(cx, A(t));
+                    break;
+            case 99:    /* DOTIMES */
+                    v=doloop(cx, p, 0);
+                    break;
+            case 100:    /* DOLIST */
+                    v=doloop(cx, p, 1);
+                    break;
+            case 101:    /* APPLY */
+                    check_arity(cx, p, 2, ar_ef);
+                    t=E1;
+                    p=E2;
+                    for (j=p; dottedpair(type(j)); j=B(j)) ;
+                    if (j != cx->nilptr) error(cx, "APPLY application: an argument list expected");
+                    goto reapply;
+            case 102:    /* FUNCALL */
+                    if (p EQ cx->nilptr) error(cx, "FUNCALL application: a function expected");
+                    t=E1;
+                    p=B(p);
+                reapply:
+                    /* t is applied to the list p of the values of its arguments, which is kept
+                       by the eaL frame of this call, like the evaluated arguments of any function */
+                    ty=type(t);
+                    if (!fctform(ty))
+                    {
+                        sprintf(cx->sout, "%s application: a function or special form expected", cx->Atab[ptrv(ar_ef)].name);
+                        error(cx, cx->sout);
+                    }
+                    ar_ef=t;
+                    pa=f=ptrv(t);
+                    if (!unnamedfsf(ty)) f=ptrv(cx->Atab[f].L);
+                    /* a builtin gets the values of futures, see above; a touched future
+                       stands for its value, so it is replaced by it in the list */
+                    if (ty EQ 10 && f != 3 && f != 10)
+                        for (j=p; j != cx->nilptr; j=B(j))
+                            if (type(A(j)) EQ 2) A(j)=touch(cx, A(j));
+                    goto dispatch;
+            case 103:    /* SORT */
+                    check_arity(cx, p, 2, ar_ef);
+                    for (j=E1; dottedpair(type(j)); j=B(j)) ;
+                    if (j != cx->nilptr) error(cx, "SORT application: a list expected");
+                    if (!fctform(type(E2))) error(cx, "SORT application: a predicate expected");
+                    v=lsort(cx, E1, E2);
+                    break;
 
-            default:  error("dryrot: bad builtin case number");
+            default:  error(cx, "dryrot: bad builtin case number");
         } /* end of switch cases */
     } /* end of builtins */
     /*pop the eaL list or pop the currentin list, whichever is active */
-    if (fct(ty)) eaLp=B(eaLp);
+done:
+    if (ea) eaLp=B(eaLp);
     else cilp=B(cilp);
+    if (uk) skp=B(skp);
 
     Return(v);
 }
 
-void check_arity(int32 p, uint8_t ar, int32 f)
+void check_arity(struct Lispctx *cx, int32 p, uint8_t ar, int32 f)
 /*-------------------------------------------------
 Checks whether the given argument list p contains
 exactly ar arguments.
@@ -1278,48 +2419,185 @@ Signals an error if:
 -------------------------------------------------*/
 {
     char msg[60];
-    for (; ar>0 && p!=nilptr; ar--, p=B(p))
+    for (; ar>0 && p!=cx->nilptr; ar--, p=B(p))
     { }
-    if (ar EQ 0 && p EQ nilptr) return;
+    if (ar EQ 0 && p EQ cx->nilptr) return;
     else
     {   /* for the purposes of check_arity, strcat works perfectly as the string concatenator */
-        strcpy(msg, Atab[ptrv(f)].name);
+        strcpy(msg, cx->Atab[ptrv(f)].name);
         strcat(msg, " application: ");
 
         if (ar>0)
             strcat(msg, "not enough arguments");
         else
             strcat(msg, "too many arguments");
-        error(msg);
+        error(cx, msg);
     }
 }
 
-int32 newloc(int32 x, int32 y)
+int32 newloc(struct Lispctx *cx, int32 x, int32 y)
 /*-------------------------------------------------
 Allocates and loads the fields of a new location in the list area. The car field is set to X
 and the cdr filed is set to Y. The index of the new location is returned.
 -------------------------------------------------*/
 {
     int32 j;
-    if (fp<0)
+#ifdef GOVOL_GCSTRESS
+    if (1)  /* collect at every allocation, so that a node left unkept is lost at once */
+#else
+    if (cx->fp<0)
+#endif
     {   /* GC if not enough space: */
-        gcmark(x); gcmark(y);
-        gc();
-        if (fp<0) error("out of space");
+        gcmark(cx, x); gcmark(cx, y);
+        gc(cx, GC_LIST);
+        if (cx->fp<0) error(cx, "out of space");
     }
 
     /* fp points to the first free list node.
        For each free list node f, B(f) points to the next free list node: */
-    j=fp;       /* allocate the first free list cell for the new values */
-    fp=B(j);    /* update the free list pointer to point to the next free list cell */
-    A(j)=x;     /* set the CAR of the newly allocated list cell to x */
-    B(j)=y;     /* set the CDR of the newly allocated list cell to y */
-    numf--;     /* update the number of free list cells */
+    j=cx->fp;       /* allocate the first free list cell for the new values */
+    cx->fp=Bl(j);   /* update the free list pointer to point to the next free list cell */
+    cx->P[j].car=x; /* set the CAR of the newly allocated list cell to x */
+    Bl(j)=y;    /* set the CDR of the newly allocated list cell to y */
+    cx->numf--;     /* update the number of free list cells */
+    cx->gcs.allocated++;
     return(j);  /* return the pointer to the recently allocated list cell */
 }
 
+/* LIST LAYOUT:
+   A proper list made by sread, LIST or APPEND is CDR-coded: its k nodes are
+   k consecutive words of the compact list area Cw, which hold the CARs, and
+   the CDR of every node is told by its CDR-code in Cc, CC_NEXT for the next
+   word or CC_NIL for NIL. Such a list takes one word and a code byte for an
+   element instead of the two words of a list area node, and walking down its
+   CDRs walks up memory. A() and B() read a node of either kind, so the rest
+   of the interpreter does not tell them apart; only setcdr() changes a CDR,
+   and when it changes the CDR of a compact node to anything else than what
+   its code says, it splits the node: a new list area node gets the CAR and
+   the new CDR, and the word becomes a CC_FWD pointer to it. The node keeps
+   its index, so it stays EQ to itself, and A() and B() follow the pointer.
+   A() and B() read a node in line and only call carp() and cdrof() for a
+   split one (or for the end of a compact list, in B()). The evaluator keeps
+   to list area nodes all the same: the argument lists it builds, the
+   optimized bodies and the parameter lists LAMBDA and SPECIAL take are made
+   of them (see codecopy), so a function call pays for no CDR-code.
+   The compact area is allocated from ctop upwards and only reclaimed by
+   gc(), which sets the words of the unreachable nodes free and ctop back to
+   0; when there is no run of k free words above ctop, newlist falls back on
+   the free space list of the list area, which is kept in address order so
+   that its nodes are neighbours there, too. */
+
+int32 *carp(struct Lispctx *cx, int32 j)
+/* the address of the CAR of the compact node j */
+{
+    j-=l;
+    return (cx->Cc[j] EQ CC_FWD)? &cx->P[cx->Cw[j]].car : &cx->Cw[j];
+}
+
+int32 cdrof(struct Lispctx *cx, int32 j)
+/* the CDR of the compact node j */
+{
+    switch (cx->Cc[j-l])
+    {
+        case CC_NEXT:   return se(j+1);
+        case CC_FWD:    return cx->P[cx->Cw[j-l]].cdr;
+        default:        return cx->nilptr;  /* CC_NIL, or a free word, which gcmark may find in a free node */
+    }
+}
+
+void setcdr(struct Lispctx *cx, int32 j, int32 v)
+/* sets the CDR of the node j, which is kept by the caller, to v */
+{
+    int32 i=j-l, t;
+
+    if (j < l) {cx->P[j].cdr=v; return;}
+    if (cx->Cc[i] EQ CC_FWD) {cx->P[cx->Cw[i]].cdr=v; return;}
+    if (v EQ ((cx->Cc[i] EQ CC_NIL)? cx->nilptr : se(j+1))) return;
+    /* split the node; newloc keeps j and v over a collection */
+    t=newloc(cx, se(j), v);
+    cx->P[t].car=cx->Cw[i];
+    cx->Cw[i]=t;
+    cx->Cc[i]=CC_FWD;
+}
+
+int32 newrun(struct Lispctx *cx, int32 k)
+/*-------------------------------------------------
+  Returns a compact list of k new nodes whose CARs
+  are NIL, or -1 if there is no run of k free words
+  above ctop. Never collects.
+-------------------------------------------------*/
+{
+    int32 i, j;
+
+    if (k <= 0 || k > cx->cnumf) return -1;
+    for (i=cx->ctop; i+k <= lc; i=j+1)
+    {
+        for (j=i; j<i+k && cx->Cc[j] EQ CC_FREE; j++) ;
+        if (j EQ i+k) break;
+    }
+    if (i+k > lc) return -1;
+    for (j=i; j<i+k; j++)
+    {
+        cx->Cw[j]=cx->nilptr;
+        cx->Cc[j]=CC_NEXT;
+    }
+    cx->Cc[i+k-1]=CC_NIL;
+    cx->ctop=i+k;
+    if (cx->ctop > cx->chigh) cx->chigh=cx->ctop;
+    cx->cnumf-=k;
+    cx->gcs.allocated+=k;
+    return l+i;
+}
+
+int32 newlist(struct Lispctx *cx, int32 k)
+/*-------------------------------------------------
+  Returns a list of k new nodes whose CARs are NIL:
+  a compact one if there is room, else the first k
+  nodes of the free space list, which already links
+  them in address order. The caller keeps what it
+  needs over a collection.
+-------------------------------------------------*/
+{
+    int32 j, t, i;
+
+    if (k <= 0) return cx->nilptr;
+    if ((j=newrun(cx, k)) >= 0) return j;
+    if (cx->numf < k)
+    {
+        gc(cx, GC_LIST);
+        if (cx->numf < k) error(cx, "out of space");
+    }
+    j=t=cx->fp;
+    for (i=1; i<k; i++)
+    {
+        A(t)=cx->nilptr;
+        t=Bl(t);
+    }
+    A(t)=cx->nilptr;
+    cx->fp=Bl(t);
+    Bl(t)=cx->nilptr;
+    cx->numf-=k;
+    cx->gcs.allocated+=k;
+    return j;
+}
+
+int32 compactcopy(struct Lispctx *cx, int32 x)
+/*-------------------------------------------------
+  Returns a compact copy of the proper list x, or x
+  itself if there is no room for one. Never
+  collects, so x needs no protection.
+-------------------------------------------------*/
+{
+    int32 k, t, v;
+
+    for (k=0, t=x; dottedpair(type(t)); t=B(t)) k++;
+    if (t != cx->nilptr || (v=newrun(cx, k)) < 0) return x;
+    for (t=v; x != cx->nilptr; x=B(x), t++) cx->Cw[t-l]=A(x);
+    return v;
+}
+
 /* GARBAGE COLLECTOR: */
-void gc(void)
+void gc(struct Lispctx *cx, int16 why)
 /*-------------------------------------------------
   gc is the main garbage collection function that
   takes care of the actual GC process. it uses
@@ -1327,9 +2605,19 @@ void gc(void)
   can be reached by the atoms established in the
   atom table before it handles the garbage collection
   process.
+  why tells who asked for the collection (GC_LIST,
+  GC_NUM or GC_CALL); it is only used for the
+  statistics in gcs.
 -------------------------------------------------*/
 {
-    int32 i, t;
+    int32 i, t, numf0;
+    struct timespec t0, t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    cx->gcs.count[why]++;
+    numf0 = cx->numf;
+    if (cx->numf < cx->gcs.numflow) cx->gcs.numflow = cx->numf;
+
     /* For marking list pointers to be saved, we set the 28th bit in their pointers to 1.
        Thus to see if a list pointer is marked, we check whether its 28th bit is set. */
     #define marked(p)   ((A(p) & 0x08000000)!=0)
@@ -1338,62 +2626,110 @@ void gc(void)
     /* Mark everything reachable from the atom table */
     for (i=0; i<m; i++)
     {
-        gcmark(Atab[i].L);      /* mark the atom value */
-        gcmark(Atab[i].bl);     /* mark the bind list */
-        gcmark(Atab[i].plist);  /* mark the property list */
+        gcmark(cx, cx->Atab[i].L);      /* mark the atom value */
+        gcmark(cx, cx->Atab[i].bl);     /* mark the bind list */
+        gcmark(cx, cx->Atab[i].plist);  /* mark the property list */
+        gcmark(cx, cx->Atab[i].pix);    /* and its index */
+        gcmark(cx, cx->Atab[i].opt);    /* the optimized body of a function */
         /* A list node is reachable if it can be reached from either the
            atom value, the bind-list  or the property list of any atom.
            All other list nodes are left unmarked. */
     }
+    /* and from the caches of the memoized functions */
+    for (i=0; i<NMEMO; i++)
+        if (cx->Mtab[i].fn >= 0)
+        {
+            gcmark(cx, cx->Mtab[i].def);
+            markobj(cx, tp(0x30000000, cx->Mtab[i].kv));
+            cx->vmark[cx->Mtab[i].ix]=1;
+        }
+    if (cx->hctab >= 0) cx->vmark[cx->hctab]=1;     /* but not the nodes in it */
 
     /* gcmark has set nmark[i] for every number Ntab[i].num reachable from the atom table
        or from a list-node. Now we garbage collect the number table by re-storing every
        reachable number, and claiming the rest for reuse. */
     for (i=0; i<n; i++)
-        nx[i]=-1;
+        cx->nx[i]=-1;
 
     /* EX 27.8 - we need to also recalculate the amount of numbers in the number table after
        the garbage colleciton has finished. First, reset nnums: */
-       nnums = 0;
+       cx->nnums = 0;
 
-    for (nf=-1, i=0; i<n; i++)
+    for (cx->nf=-1, i=0; i<n; i++)
     {
-        if (nmark[i] EQ 0)
+        if (cx->nmark[i] EQ 0)
         {
-            Ntab[i].nlink=nf;
-            nf=i;
+            cx->Ntab[i].nlink=cx->nf;
+            cx->nf=i;
         }
         else /* restore num[i] */
         {
-            t = hashnum(Ntab[i].num);
-            while (nx[t] != -1) if ((++t) EQ n) t=0;
+            t = hashnum(cx->Ntab[i].num);
+            while (cx->nx[t] != -1) if ((++t) EQ n) t=0;
 
-            nx[t]=i;
-            nmark[i]=0;
+            cx->nx[t]=i;
+            cx->nmark[i]=0;
             /* EX 27.8 - add one to nnums for each kept number in the number table.
                Another way to do this would be in gcmark, when marking the numbers,
                but then marknum would get a bit bloated... */
-            nnums++;
-        }
-
-        /* build the new list-node free-space list and return.
-           Naturally, both the free-space head pointer and the number of list nodes
-           have to be recalculated as well. */
-        fp=-1; numf=0;
-        for (i=1; i<l; i++)
-            if (!marked(i))
-            {   /* We do not have to clear the CAR of any free lists, because they are
-                   unreachable for as long as they are free. Once they become occupied,
-                   the old CAR-value is replaced with a new value. */
-                B(i)=fp;
-                fp=i;
-                numf++;
-            }
-            else unmark(i);
+            cx->nnums++;
+        }
+    }
+
+    /* build the new list-node free-space list and return.
+       Naturally, both the free-space head pointer and the number of list nodes
+       have to be recalculated as well.
+       (This loop used to sit inside the number table loop above, and since both
+       loops share i, only Ntab[0] was ever restored into nx.) */
+    hcprune(cx);  /* while the marks are there to tell */
+
+    /* the unmarked words of the compact list area are free; the mark of a
+       CC_FWD word is on its list area node, which the loop below unmarks */
+    for (cx->cnumf=lc-cx->chigh, t=0, i=0; i<cx->chigh; i++)
+    {
+        if (cx->Cc[i] EQ CC_FREE) {cx->cnumf++; continue;}
+        else if (cx->Cc[i] EQ CC_FWD)
+        {
+            if (!(cx->P[cx->Cw[i]].car & 0x08000000)) {cx->Cc[i]=CC_FREE; cx->cnumf++; continue;}
+        }
+        else if (cx->Cw[i] & 0x08000000) cx->Cw[i] &= 0xf7ffffff;
+        else {cx->Cc[i]=CC_FREE; cx->cnumf++; continue;}
+        t=i+1;
     }
+    cx->ctop=0;
+    cx->chigh=t;
+
+    /* the free space list ends in NIL: gcmark takes the atom of a named function
+       (typecodes 12 and 13) for a list node, which may be a free one, and must
+       not follow its CDR out of the list area */
+    cx->fp=cx->nilptr; cx->numf=0;
+    for (i=l-1; i>=1; i--)  /* so that the free space list is in address order */
+        if (!(cx->P[i].car & 0x08000000))
+        {   /* We do not have to clear the CAR of any free lists: gcmark may only
+               get to them as said above, and a free node holds what a node held
+               before. Once they become occupied, the old CAR-value is replaced
+               with a new value. */
+            Bl(i)=cx->fp;
+            cx->fp=i;
+            cx->numf++;
+        }
+        else cx->P[i].car &= 0xf7ffffff;
+
+    futsweep(cx);
+    vsweep(cx);
+    hsweep(cx);
+    ssweep(cx);
+    bsweep(cx);
+    osweep(cx);
+
+    cx->gcs.reclaimed += cx->numf-numf0;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    cx->gcs.pauselast = (t1.tv_sec-t0.tv_sec)*1e9 + (t1.tv_nsec-t0.tv_nsec);
+    cx->gcs.pausetot += cx->gcs.pauselast;
+    if (cx->gcs.pauselast > cx->gcs.pausemax) cx->gcs.pausemax = cx->gcs.pauselast;
 }
 
-void gcmark(int32 p)
+void gcmark(struct Lispctx *cx, int32 p)
 /*-------------------------------------------------
   gcmark marks all those numbers and list nodes,
   that are reachable, from being GCd.
@@ -1402,9 +2738,9 @@ void gcmark(int32 p)
   functional recursion is used to achieve this)
 -------------------------------------------------*/
 {
-static int32 s, t;
-#define marknode(p)     (A(p) |= 0x08000000)            /* Marks the CAR of a list p */
-#define marknum(t,p)    if ((t) EQ 9) nmark[ptrv(p)]=1  /* If p is a number, marks p */
+int32 s, t, *c;
+#define marknum(t,p)    if ((t) EQ 9) cx->nmark[ptrv(p)]=1; else if ((t)>1 && (t)<8) markobj(cx, p)
+                        /* If p is a number, marks p, the other atomic objects are marked by markobj */
 #define listp(t)        ((t) EQ 0 || (t)>11)            /* checks whether t is a list */
 
 start:
@@ -1412,15 +2748,16 @@ start:
     if (listp(t))
     {
         p=ptrv(p);
-        if (marked(p))
+        c=&A(p);    /* the CAR of p, which holds the mark */
+        if (*c & 0x08000000)
             return;
         /* If p isn't marked yet, we need to mark the list
            node p, and also both its CAR- and CDR-nodes
            recursively. */
-        marknode(p);
+        *c |= 0x08000000;
 
         /* First handle the CAR of p: */
-        t=A(p);
+        t=*c;
         if (!listp(type(t)))
         { /* If the CAR of p is not a list node, we can just mark
              it if necessary, proceed to handle the CDR of p and
@@ -1443,10 +2780,3338 @@ start:
 
         /* if the CAR and CRD of p are both lists, they
            also have to be marked: */
-        gcmark(t);  /* marks the CAR */
+        gcmark(cx, t);  /* marks the CAR */
 
         p=B(p);
         goto start; /* marks the CDR */
     }
     else marknum(t, p);
 }
+
+void markobj(struct Lispctx *cx, int32 p)
+/*-------------------------------------------------
+  Marks the objects that are neither list nodes nor
+  numbers, and what they refer to.
+-------------------------------------------------*/
+{
+    int32 i=ptrv(p), k;
+
+    switch (type(p))
+    {
+        case 2: /* future */
+            if (cx->fmark[i]) return;
+            cx->fmark[i]=1;
+            if (cx->Ftab[i].f != NULL && cx->Ftab[i].v != -1) gcmark(cx, cx->Ftab[i].v);
+            return;
+        case 3: /* vector */
+            if (cx->vmark[i]) return;
+            cx->vmark[i]=1;
+            if (cx->Vtab[i].kind EQ VK_OBJ)
+                for (k=0; k<cx->Vtab[i].len; k++) gcmark(cx, cx->Vs[cx->Vtab[i].base+k]);
+            return;
+        case 4: /* hash table: its vectors hold the keys and the values */
+            if (cx->hmark[i]) return;
+            cx->hmark[i]=1;
+            markobj(cx, tp(0x30000000, cx->Htab[i].nv));
+            if (cx->Htab[i].ov >= 0) markobj(cx, tp(0x30000000, cx->Htab[i].ov));
+            return;
+        case 5: /* string: its bytes */
+            cx->smark[i]=1;
+            cx->vmark[cx->Stab[i].buf]=1;
+            return;
+        case 6: /* big integer: its limbs */
+            cx->bmark[i]=1;
+            cx->vmark[cx->Btab[i].buf]=1;
+            return;
+        case 7: /* promise: its expression and bindings, or its value */
+            if (cx->omark[i]) return;
+            cx->omark[i]=1;
+            if (cx->Otab[i].kind EQ OK_PROMISE)
+            {
+                gcmark(cx, cx->Otab[i].a);
+                gcmark(cx, cx->Otab[i].b);
+            }
+            return;
+    }
+}
+
+int16 gcfields(struct Lispctx *cx, char *name[], double val[])
+/*-------------------------------------------------
+  Loads the names and the current values of the
+  gcs statistics into name and val and returns
+  their count. Used by both gcstats and gcreport.
+-------------------------------------------------*/
+{
+    int16 k=0;
+    #define FIELD(s, x) {name[k]=(s); val[k++]=(x);}
+
+    FIELD("COLLECTIONS",    cx->gcs.count[GC_LIST]+cx->gcs.count[GC_NUM]+cx->gcs.count[GC_CALL]);
+    FIELD("BY-NEWLOC",      cx->gcs.count[GC_LIST]);
+    FIELD("BY-NUMATOM",     cx->gcs.count[GC_NUM]);
+    FIELD("ALLOCATED",      cx->gcs.allocated);
+    FIELD("RECLAIMED",      cx->gcs.reclaimed);
+    FIELD("FREE",           cx->numf);
+    FIELD("FREE-LOW",       (cx->numf < cx->gcs.numflow)? cx->numf : cx->gcs.numflow);
+    FIELD("COMPACT-FREE",   cx->cnumf);
+    FIELD("NUMBERS",        cx->nnums);
+    FIELD("NUMBERS-PEAK",   cx->gcs.nnumspeak);
+    FIELD("PROBES-AVG",     (cx->gcs.lookups EQ 0)? 0.0 : (double)cx->gcs.probes/cx->gcs.lookups);
+    FIELD("PROBES-MAX",     cx->gcs.probemax);
+    FIELD("ATOMS",          cx->gcs.natoms);
+    FIELD("PAUSE-TOTAL-MS", cx->gcs.pausetot/1e6);
+    FIELD("PAUSE-MAX-MS",   cx->gcs.pausemax/1e6);
+    FIELD("PAUSE-LAST-MS",  cx->gcs.pauselast/1e6);
+    return k;
+}
+
+int32 gcstats(struct Lispctx *cx)
+/*-------------------------------------------------
+  Returns the gc statistics as an association list
+  ((COLLECTIONS . 3) (BY-NEWLOC . 1) ...).
+-------------------------------------------------*/
+{
+    char *name[20];
+    double val[20];
+    int16 k;
+    int32 v;
+
+    /* take the snapshot first, building the list must not show up in it */
+    k=gcfields(cx, name, val);
+
+    /* protect the list under construction by pushing it on the skp list,
+       just like sread does; numatom or newloc may call gc on the way. */
+    skp=newloc(cx, cx->nilptr, skp);
+    while (k-->0)
+        A(skp)=newloc(cx, newloc(cx, ordatom(cx, name[k]), numatom(cx, val[k])), A(skp));
+    v=A(skp);
+    skp=B(skp);
+    return v;
+}
+
+void gcreport(struct Lispctx *cx)
+/*-------------------------------------------------
+  Prints the gc statistics, one field per line.
+-------------------------------------------------*/
+{
+    char *name[20];
+    double val[20];
+    int16 i, k;
+
+    k=gcfields(cx, name, val);
+    ourprint(cx, "\ngc statistics:\n");
+    for (i=0; i<k; i++)
+    {
+        sprintf(cx->sout, "  %-16s %g\n", name[i], val[i]);
+        ourprint(cx, cx->sout);
+    }
+}
+
+/* heapreport's bookkeeping, kept in one place so that it can be sorted */
+struct Heaprow {int32 a; int32 total, retained, shared, val, bl, plist;};
+
+int heapcmp(const void *x, const void *y)
+/* order heap report rows by decreasing retained, then total cells */
+{
+    struct Heaprow *r=(struct Heaprow *)x, *s=(struct Heaprow *)y;
+    if (r->retained != s->retained) return s->retained - r->retained;
+    return s->total - r->total;
+}
+
+int32 heapwalk(struct Lispctx *cx, int32 p, int32 *stack, int32 *rstamp, int32 rgen, int32 *astamp, int32 agen,
+               uint16_t *refc, char *nreach, int16 pass, struct Heaprow *row)
+/*-------------------------------------------------
+  Walks the list cells reachable from the typed
+  pointer p with the explicit stack, without
+  touching the gc mark bits. A cell is visited once
+  per root (rstamp EQ rgen) and counted once per
+  atom (astamp EQ agen). In pass 0 every cell
+  counts the atoms reaching it in refc, and the
+  reachable numbers are flagged in nreach. In pass
+  1 the cells of the atom are split by refc into
+  retained and shared ones. Returns the number of
+  cells reachable from this root.
+-------------------------------------------------*/
+{
+    int32 sp=0, k=0, t, j;
+
+    stack[sp++]=p;
+    while (sp>0)
+    {
+        p=stack[--sp];
+        t=type(p);
+        if (t EQ 9) {nreach[ptrv(p)]=1; continue;}
+        if (!(t EQ 0 || t>11)) continue;    /* not a list, see listp in gcmark */
+        j=ptrv(p);
+        if (j EQ 0 || j>=l+lc || rstamp[j] EQ rgen) continue;
+        rstamp[j]=rgen;
+        k++;
+        if (astamp[j] != agen)
+        {
+            astamp[j]=agen;
+            if (pass EQ 0) refc[j]++;
+            else if (refc[j] EQ 1) row->retained++;
+            else row->shared++;
+            row->total++;
+        }
+        stack[sp++]=B(j);
+        stack[sp++]=A(j);
+    }
+    return k;
+}
+
+void heapreport(struct Lispctx *cx)
+/*-------------------------------------------------
+  Prints a census of the list area: for every atom
+  the list cells reachable from its value, bind
+  list and property list, split into the cells
+  reachable only from this atom (retained) and the
+  ones shared with other atoms. The rows are sorted
+  by retained cells, so leaks and bloated property
+  lists come first. The internal stacks currentin,
+  eaL and sreadlist, and the reachability of the
+  number table entries are reported separately.
+-------------------------------------------------*/
+{
+    int32 i, k, nrows, gen, reach, creach, nlive, *stack, *rstamp, *astamp;
+    int16 pass;
+    uint16_t *refc;
+    char *nreach;
+    struct Heaprow *rows, *r;
+
+    stack  = (int32 *)calloc(2*(l+lc)+1, sizeof(int32));
+    rstamp = (int32 *)calloc(l+lc, sizeof(int32));     /* indexed by node, compact ones too */
+    astamp = (int32 *)calloc(l+lc, sizeof(int32));
+    refc   = (uint16_t *)calloc(l+lc, sizeof(uint16_t));
+    nreach = (char *)calloc(n, sizeof(char));
+    rows   = (struct Heaprow *)calloc(m, sizeof(struct Heaprow));
+
+    for (gen=0, pass=0; pass<2; pass++)
+        for (nrows=0, i=0; i<m; i++)
+        {
+            if (cx->Atab[i].name[0] EQ EOS) continue;
+            r=&rows[nrows];
+            memset(r, 0, sizeof(*r));
+            r->a=i;
+            k=++gen;
+            r->val   = heapwalk(cx, cx->Atab[i].L,     stack, rstamp, ++gen, astamp, k, refc, nreach, pass, r);
+            r->bl    = heapwalk(cx, cx->Atab[i].bl,    stack, rstamp, ++gen, astamp, k, refc, nreach, pass, r);
+            r->plist = heapwalk(cx, cx->Atab[i].plist, stack, rstamp, ++gen, astamp, k, refc, nreach, pass, r);
+            if (r->total>0) nrows++;
+        }
+
+    /* every cell with a nonzero refc is reachable from some atom */
+    for (reach=0, i=1; i<l; i++)
+        if (refc[i]>0) reach++;
+    for (creach=0, i=l; i<l+lc; i++)
+        if (refc[i]>0) creach++;
+    for (nlive=0, i=0; i<n; i++)
+        if (nreach[i]) nlive++;
+
+    sprintf(cx->sout, "\nlist area: %d cells, %d free, %d reachable, %d garbage\n",
+            l-1, cx->numf, reach, l-1-cx->numf-reach);
+    ourprint(cx, cx->sout);
+    sprintf(cx->sout, "compact list area: %d words, %d free, %d reachable, %d garbage\n",
+            lc, cx->cnumf, creach, lc-cx->cnumf-creach);
+    ourprint(cx, cx->sout);
+    sprintf(cx->sout, "number table: %d entries, %d used, %d reachable, %d garbage\n",
+            n, cx->nnums, nlive, cx->nnums-nlive);
+    ourprint(cx, cx->sout);
+    ourprint(cx, "internal stacks:");
+    for (i=0; i<nrows; i++)
+        if (rows[i].a EQ cx->currentin || rows[i].a EQ cx->eaL || rows[i].a EQ cx->sk)
+        {
+            sprintf(cx->sout, " %s %d", cx->Atab[rows[i].a].name, rows[i].total);
+            ourprint(cx, cx->sout);
+        }
+
+    qsort(rows, nrows, sizeof(struct Heaprow), heapcmp);
+    sprintf(cx->sout, "\n\n%-16s %8s %8s %8s %8s %8s %8s\n",
+            "ATOM", "RETAINED", "SHARED", "TOTAL", "VALUE", "BINDS", "PLIST");
+    ourprint(cx, cx->sout);
+    for (r=rows; r<rows+nrows; r++)
+    {
+        sprintf(cx->sout, "%-16s %8d %8d %8d %8d %8d %8d\n", cx->Atab[r->a].name,
+                r->retained, r->shared, r->total, r->val, r->bl, r->plist);
+        ourprint(cx, cx->sout);
+    }
+
+    free(stack); free(rstamp); free(astamp); free(refc);
+    free(nreach); free(rows);
+}
+
+#ifndef GOVOL_NOMAIN
+/* THE EVALUATION SERVER:
+   Reading lispinit into a fresh interpreter for every piece of work costs far
+   more than the work itself, so the server reads it once into the context
+   warm, and evaluates every request in its own copy of warm (clonectx). The
+   requests are thus isolated from each other: definitions made by one are
+   not seen by the next one, and an error or an exceeded limit only ends the
+   request it happened in.
+
+   A request is a frame: a 4-byte big-endian length followed by that many
+   bytes of S-expressions. The reply is a frame holding what the REPL would
+   have printed for them, one result or error message per line. */
+
+struct Lispctx *warm;
+
+void warmup(void)
+/* set up warm and read lispinit into it */
+{
+    FILE *in;
+    struct Lispctx *cx;
+
+    cx=warm=newctx();
+    cx->outfp=fopen("/dev/null", "w");  /* the REPL would echo the lispinit results */
+    if (cx->outfp EQ NULL || (in=fopen("/dev/null", "r")) EQ NULL)
+    {
+        perror("govol");
+        exit(1);
+    }
+    if (evalall(cx, in) > 0)
+        fprintf(stderr, "govol: errors in lispinit\n");
+    if (cx->filep EQ in) {fclose(in); cx->filep=NULL;}     /* lispinit has been read through */
+    fclose(cx->outfp);
+    cx->outfp=stdout;
+    signal(SIGPIPE, SIG_IGN);       /* a client closing early must not kill the server */
+}
+
+char *evalrequest(char *req, uint32_t len, size_t *outlen)
+/*---------------------------------------------------------------
+  Evaluates the len bytes of S-expressions in req in a new copy
+  of warm, within the srvtime and srvcells limits. Returns the
+  malloc'ed output and its length in outlen.
+---------------------------------------------------------------*/
+{
+    struct Lispctx *cx;
+    char *out;
+
+    cx=clonectx(warm);
+    cx->outfp=open_memstream(&out, outlen);
+    cx->deadline=(srvtime>0)? nsclock()+srvtime*1e6 : 0;
+    cx->alloclimit=(srvcells>0)? cx->gcs.allocated+srvcells : 0;
+    evalall(cx, fmemopen(req, len, "r"));
+    fclose(cx->outfp);
+    freectx(cx);    /* closes the request stream, wherever @ has left it */
+    return out;
+}
+
+int16 rwall(int fd, char *buf, size_t k, int16 wr)
+/* reads (wr EQ 0) or writes exactly k bytes; returns 0 on EOF or error */
+{
+    ssize_t r;
+
+    while (k>0)
+    {
+        r=wr? write(fd, buf, k) : read(fd, buf, k);
+        if (r<0 && errno EQ EINTR) continue;
+        if (r<=0) return 0;
+        buf+=r; k-=r;
+    }
+    return 1;
+}
+
+void serveconn(int in, int out)
+/* answers the request frames read from in until it ends */
+{
+    unsigned char h[4];
+    uint32_t len;
+    size_t k;
+    char *req, *rep;
+
+    while (rwall(in, (char *)h, 4, 0))
+    {
+        len=((uint32_t)h[0]<<24) | (h[1]<<16) | (h[2]<<8) | h[3];
+        if (len > (1<<24)) return;  /* not a request of ours */
+        req=(char *)malloc(len+1);
+        if (!rwall(in, req, len, 0)) {free(req); return;}
+        rep=evalrequest(req, len, &k);
+        free(req);
+        h[0]=k>>24; h[1]=k>>16; h[2]=k>>8; h[3]=k;
+        len=rwall(out, (char *)h, 4, 1) && rwall(out, rep, k, 1);
+        free(rep);
+        if (!len) return;
+    }
+}
+
+void *srvworker(void *arg)
+/* one thread of the worker pool: serves one connection at a time */
+{
+    int lfd=*(int *)arg, fd;
+
+    for (;;)
+    {
+        if ((fd=accept(lfd, NULL, NULL)) < 0) continue;
+        serveconn(fd, fd);
+        close(fd);
+    }
+    return NULL;
+}
+
+int serve(char *path, int16 nworkers)
+/*---------------------------------------------------------------
+  Serves requests on the Unix domain socket path with a pool of
+  nworkers threads, each one serving a connection at a time.
+---------------------------------------------------------------*/
+{
+    static int lfd;
+    struct sockaddr_un a;
+    pthread_t t;
+    int16 i;
+
+    warmup();
+    memset(&a, 0, sizeof(a));
+    a.sun_family=AF_UNIX;
+    strncpy(a.sun_path, path, sizeof(a.sun_path)-1);
+    unlink(path);
+    if ((lfd=socket(AF_UNIX, SOCK_STREAM, 0)) < 0
+        || bind(lfd, (struct sockaddr *)&a, sizeof(a)) < 0 || listen(lfd, 64) < 0)
+    {
+        perror("govol");
+        return 1;
+    }
+    for (i=1; i<nworkers; i++)
+        pthread_create(&t, NULL, srvworker, &lfd);
+    srvworker(&lfd);
+    return 0;
+}
+
+int serveframes(void)
+/* serves the request frames on stdin, replying on stdout */
+{
+    warmup();
+    serveconn(0, 1);
+    return 0;
+}
+
+/* BATCH MODE:
+   Every file is a job of its own, evaluated like the REPL would evaluate it
+   when piped in, but without prompts and echoes: the file is read by
+   evalall, not through stdin. lispinit is read once into warm, and every
+   job runs in a child process forked from it, so the children share the
+   warmed-up tables copy-on-write. A job's output and error messages go to
+   FILE.out; its exit status is the number of errors (at most 100), or 101
+   if the file cannot be read. */
+
+void runjob(char *file)
+/* the child process of one batch job, which evaluates in warm */
+{
+    struct Lispctx *cx=warm;
+    char *out;
+    FILE *in;
+    int32 e;
+
+    out=(char *)malloc(strlen(file)+5);
+    sprintf(out, "%s.out", file);
+    if ((in=fopen(file, "r")) EQ NULL || (cx->outfp=fopen(out, "w")) EQ NULL) _exit(101);
+    cx->deadline=(srvtime>0)? nsclock()+srvtime*1e6 : 0;
+    cx->alloclimit=(srvcells>0)? cx->gcs.allocated+srvcells : 0;
+    e=evalall(cx, in);
+    fclose(cx->outfp);
+    _exit((e>100)? 100 : e);
+}
+
+int batch(char **files, int nfiles, int16 njobs)
+/*---------------------------------------------------------------
+  Runs the nfiles files as batch jobs, at most njobs of them at
+  a time, and prints a summary. Returns 1 if any job failed.
+---------------------------------------------------------------*/
+{
+    pid_t pid, *pids;
+    int i, st, next, running, failed=0;
+    double t0;
+
+    warmup();
+    pids=(pid_t *)calloc(nfiles, sizeof(pid_t));
+    t0=nsclock();
+    for (next=running=0; next<nfiles || running>0; )
+    {
+        if (next<nfiles && running<njobs)
+        {
+            fflush(NULL);   /* the children must not repeat buffered output */
+            if ((pid=fork()) EQ 0) runjob(files[next]);
+            if (pid<0)
+            {   /* start no more jobs, but wait for the ones running */
+                perror("govol");
+                for (i=next; i<nfiles; i++) printf("%s: not started\n", files[i]);
+                failed+=nfiles-next;
+                next=nfiles;
+                continue;
+            }
+            pids[next++]=pid;
+            running++;
+            continue;
+        }
+        if ((pid=wait(&st)) < 0) break;
+        running--;
+        for (i=0; i<next && pids[i]!=pid; i++);
+        if (!WIFEXITED(st) || WEXITSTATUS(st) != 0)
+        {
+            failed++;
+            if (!WIFEXITED(st)) printf("%s: crashed\n", files[i]);
+            else if (WEXITSTATUS(st) EQ 101) printf("%s: cannot read it or write %s.out\n", files[i], files[i]);
+            else printf("%s: %d errors\n", files[i], WEXITSTATUS(st));
+        }
+    }
+    t0=(nsclock()-t0)/1e9;
+    printf("%d jobs, %d failed, %.3f s, %.1f jobs/s\n", nfiles, failed, t0, (t0>0)? nfiles/t0 : 0.0);
+    free(pids);
+    return failed>0;
+}
+#endif /* GOVOL_NOMAIN */
+
+/* PARALLEL MAP:
+   (PMAP f list) applies the function f to every element of list, like a
+   LISP-level MAP would, but splits the list between worker threads. Every
+   worker evaluates in its own copy of the calling context (clonectx), so
+   it has a private list area and sees the same atoms and values as the
+   caller. f should therefore be pure: assignments made by it are lost.
+   The results are encoded into a flat byte buffer by the worker (xencode)
+   and decoded into the caller's list area once the workers are done
+   (xdecode), in list order, so the result is the same as with a serial
+   map. An error in a worker is signaled again in the caller, as the
+   error of the first failing element. */
+
+#define PMAPMIN 16  /* a worker should get at least this many elements */
+#define PMAPMAXW 64 /* and there are at most this many workers */
+
+struct Xbuf {char *b; size_t k, max; long cells;};
+
+void xput(struct Xbuf *x, void *p, size_t k)
+/* append k bytes from p to the buffer x */
+{
+    if (x->k+k > x->max)
+    {
+        x->max = 2*(x->k+k)+64;
+        x->b = (char *)realloc(x->b, x->max);
+    }
+    memcpy(x->b+x->k, p, k);
+    x->k += k;
+}
+
+void xencode(struct Lispctx *cx, struct Xbuf *x, int32 v)
+/*-------------------------------------------------
+  Appends the value v to x as a type byte followed
+  by a number, an atom name, or the CAR and the CDR
+  of a list node. Lists are written along their CDR
+  chain by iteration, so only CARs recurse. Shared
+  substructures are copied once for every use.
+-------------------------------------------------*/
+{
+    int32 t, j, k;
+    char c;
+
+    for (;;)
+    {
+        t=type(v); j=ptrv(v); c=t;
+        xput(x, &c, 1);
+        switch (t)
+        {
+            case 0:  /* dotted pair */
+            case 14: /* unnamed function */
+            case 15: /* unnamed special form */
+                if (++x->cells >= l) error(cx, "value too large to copy between contexts");
+                xencode(cx, x, A(j));
+                v=B(j);
+                continue;
+            case 9:  xput(x, &cx->Ntab[j].num, sizeof(double)); return;
+            case 2:  /* a future is copied as its value */
+                x->k--;
+                v=touch(cx, v);
+                continue;
+            case 3:  /* vector: the kind, the length and the elements */
+                xput(x, &cx->Vtab[j].kind, 1);
+                xput(x, &cx->Vtab[j].len, sizeof(int32));
+                if (cx->Vtab[j].kind EQ VK_F64)
+                {
+                    xput(x, Vd(j), cx->Vtab[j].len*sizeof(double));
+                    return;
+                }
+                if ((x->cells += cx->Vtab[j].len) >= l) error(cx, "value too large to copy between contexts");
+                for (k=0; k<cx->Vtab[j].len; k++) xencode(cx, x, cx->Vs[cx->Vtab[j].base+k]);
+                return;
+            case 5:  /* string: the length and the bytes */
+                xput(x, &cx->Stab[j].len, sizeof(int32));
+                xput(x, Sb(j), cx->Stab[j].len);
+                return;
+            case 6:  /* big integer: the sign, the length and the limbs */
+                xput(x, &cx->Btab[j].neg, 1);
+                xput(x, &cx->Btab[j].len, sizeof(int32));
+                xput(x, Bd(j), cx->Btab[j].len*sizeof(uint32_t));
+                return;
+            case 4:  /* hash table: the number of entries and the keys and values */
+                xput(x, &cx->Htab[j].count, sizeof(int32));
+                skp=newloc(cx, hashkeys(cx, j), skp);
+                for (k=A(skp); k != cx->nilptr; k=B(k))
+                {
+                    xencode(cx, x, A(k));
+                    xencode(cx, x, hget(cx, j, A(k)));
+                }
+                skp=B(skp);
+                return;
+            case 1: case 8: case 10: case 11: case 12: case 13:
+                xput(x, cx->Atab[j].name, strlen(cx->Atab[j].name)+1); return;
+            default: error(cx, "value cannot be copied between contexts");
+        }
+    }
+}
+
+int32 xdecode(struct Lispctx *cx, char **pp)
+/*-------------------------------------------------
+  Builds the value encoded by xencode at *pp in the
+  context cx and advances *pp past it.
+-------------------------------------------------*/
+{
+    int32 t, j, k, head;
+    double d;
+    char c;
+
+    t=*(*pp)++;
+    switch (t)
+    {
+        case 0: case 14: case 15:
+            /* protect the list under construction on the skp list, like sread does */
+            skp=newloc(cx, cx->nilptr, skp);
+            A(skp)=head=j=newloc(cx, cx->nilptr, cx->nilptr);
+            for (;;)
+            {
+                k=xdecode(cx, pp);
+                A(j)=k;
+                if (**pp != 0) break;
+                (*pp)++;
+                k=newloc(cx, cx->nilptr, cx->nilptr);
+                Bl(j)=k;
+                j=k;
+            }
+            k=xdecode(cx, pp);
+            Bl(j)=k;
+            skp=B(skp);
+            return tp((int32)((uint32_t)t<<28), head);
+        case 9:
+            memcpy(&d, *pp, sizeof(double));
+            *pp += sizeof(double);
+            return numatom(cx, d);
+        case 3:
+            c=*(*pp)++;
+            memcpy(&k, *pp, sizeof(int32));
+            *pp += sizeof(int32);
+            skp=newloc(cx, newvec(cx, c, k), skp);
+            head=ptrv(A(skp));
+            if (c EQ VK_F64)
+            {
+                memcpy(Vd(head), *pp, k*sizeof(double));
+                *pp += k*sizeof(double);
+                k=0;
+            }
+            for (j=0; j<k; j++)
+            {
+                t=xdecode(cx, pp);
+                cx->Vs[cx->Vtab[head].base+j]=t;    /* the vector may have moved */
+            }
+            t=A(skp);
+            skp=B(skp);
+            return t;
+        case 5:
+            memcpy(&k, *pp, sizeof(int32));
+            *pp += sizeof(int32);
+            t=newstr(cx, k);
+            memcpy(Sb(ptrv(t)), *pp, k);
+            *pp += k;
+            return t;
+        case 6:
+            c=*(*pp)++;
+            memcpy(&k, *pp, sizeof(int32));
+            *pp += sizeof(int32);
+            t=newbig(cx, k);
+            cx->Btab[ptrv(t)].neg=c;
+            memcpy(Bd(ptrv(t)), *pp, k*sizeof(uint32_t));
+            *pp += k*sizeof(uint32_t);
+            return t;
+        case 4:
+            memcpy(&k, *pp, sizeof(int32));
+            *pp += sizeof(int32);
+            skp=newloc(cx, newhash(cx, k), skp);
+            skp=newloc(cx, cx->nilptr, skp);    /* for the keys */
+            for (j=0; j<k; j++)
+            {
+                A(skp)=xdecode(cx, pp);
+                hput(cx, ptrv(A(B(skp))), A(skp), xdecode(cx, pp));
+            }
+            skp=B(skp);
+            t=A(skp);
+            skp=B(skp);
+            return t;
+        default:
+            j=ptrv(ordatom(cx, *pp));
+            *pp += strlen(*pp)+1;
+            return tp((int32)((uint32_t)t<<28), j);
+    }
+}
+
+int32 apply1(struct Lispctx *cx, int32 f, int32 x)
+/* apply the function f to the single argument x */
+{
+    return seval(cx, newloc(cx, f, newloc(cx, newloc(cx, cx->quoteptr, newloc(cx, x, cx->nilptr)), cx->nilptr)));
+}
+
+int32 apply2(struct Lispctx *cx, int32 f, int32 x, int32 y)
+/* apply the function f to the arguments x and y */
+{
+    int32 v;
+
+    skp=newloc(cx, newloc(cx, newloc(cx, cx->quoteptr, newloc(cx, y, cx->nilptr)), cx->nilptr), skp);
+    A(skp)=newloc(cx, newloc(cx, cx->quoteptr, newloc(cx, x, cx->nilptr)), A(skp));
+    v=newloc(cx, f, A(skp));
+    skp=B(skp);
+    return seval(cx, v);
+}
+
+struct Pmapjob {
+    struct Lispctx *c;  /* the worker's copy of the caller's context */
+    int32 f, lst;       /* the function and the whole list */
+    long lo, hi;        /* the elements lo..hi-1 are this worker's */
+    struct Xbuf res;    /* the encoded results */
+    char *out;          /* what was printed */
+    size_t outlen;
+    int16 failed, limit;
+    char msg[80];       /* the error message if failed */
+};
+
+void *pmapworker(void *arg)
+{
+    struct Pmapjob *w=(struct Pmapjob *)arg;
+    long i;
+    int32 p;
+    volatile size_t keep=0;     /* set after the longjmp of an error */
+    struct Lispctx *cx=w->c;
+
+    cx->inworker=1;
+    cx->outfp=open_memstream(&w->out, &w->outlen);
+    if (setjmp(cx->env) EQ 0)
+    {
+        for (p=w->lst, i=0; i<w->lo; i++) p=B(p);
+        for (; i<w->hi; i++, p=B(p))
+        {
+            skp=newloc(cx, apply1(cx, w->f, A(p)), skp);   /* xencode may touch futures */
+            xencode(cx, &w->res, A(skp));
+            skp=B(skp);
+        }
+    }
+    else
+    {   /* leave out the "::message" error() has printed, the caller signals it again */
+        w->failed=1;
+        w->limit=cx->aborted;
+        strcpy(w->msg, cx->errmsg);
+        fflush(cx->outfp);
+        keep=(w->outlen > strlen(cx->errmsg)+3)? w->outlen-(strlen(cx->errmsg)+3) : 0;
+    }
+    fclose(cx->outfp);  /* this sets outlen again */
+    if (w->failed) w->outlen=keep;
+    return NULL;
+}
+
+int32 pmap(struct Lispctx *cx, int32 f, int32 lst)
+/*-------------------------------------------------
+  Returns the list of the results of applying f to
+  the elements of lst. Short lists are mapped
+  serially in the context cx.
+-------------------------------------------------*/
+{
+    long len, i, nw;
+    int32 p, v, *endv;
+    char *bp;
+    struct Pmapjob w[PMAPMAXW];
+    pthread_t t[PMAPMAXW];
+
+    for (len=0, p=lst; dottedpair(type(p)); p=B(p)) len++;
+    nw=sysconf(_SC_NPROCESSORS_ONLN);
+    if (nw > len/PMAPMIN) nw=len/PMAPMIN;
+    if (nw > PMAPMAXW) nw=PMAPMAXW;
+
+    /* build the result list by tail-consing, protected on the skp list */
+    skp=newloc(cx, cx->nilptr, skp);
+    endv=&A(skp);
+
+    if (nw <= 1)
+    {
+        for (p=lst; dottedpair(type(p)); p=B(p))
+        {
+            v=apply1(cx, f, A(p));
+            *endv=newloc(cx, v, cx->nilptr);
+            endv=&Bl(*endv);
+        }
+        v=A(skp); skp=B(skp);
+        return v;
+    }
+
+    for (i=0; i<nw; i++)
+    {
+        memset(&w[i], 0, sizeof(struct Pmapjob));
+        w[i].c=clonectx(cx);
+        w[i].f=f; w[i].lst=lst;
+        w[i].lo=len*i/nw; w[i].hi=len*(i+1)/nw;
+        pthread_create(&t[i], NULL, pmapworker, &w[i]);
+    }
+    for (i=0; i<nw; i++) pthread_join(t[i], NULL);
+
+    /* print what the workers printed, in list order, and collect their results */
+    for (i=0; i<nw; i++)
+    {
+        fwrite(w[i].out, 1, w[i].outlen, cx->outfp);
+        if (cx->logfilep != NULL) fwrite(w[i].out, 1, w[i].outlen, cx->logfilep);
+        if (w[i].failed) break;
+    }
+    if (i<nw)
+    {
+        strcpy(cx->sout, w[i].msg);
+        if (w[i].limit) cx->aborted=1;
+    }
+    else
+    {
+        for (i=0; i<nw; i++)
+            for (bp=w[i].res.b; bp<w[i].res.b+w[i].res.k; )
+            {
+                v=xdecode(cx, &bp);
+                *endv=newloc(cx, v, cx->nilptr);
+                endv=&Bl(*endv);
+            }
+    }
+    for (v=i, i=0; i<nw; i++)
+    {
+        free(w[i].out);
+        free(w[i].res.b);
+        freectx(w[i].c);
+    }
+    if (v<nw) error(cx, cx->sout);
+    v=A(skp); skp=B(skp);
+    return v;
+}
+
+/* FUTURES:
+   (FUTURE x) returns at once a future, a type-2 placeholder for the value of
+   x, and x is evaluated by a pool of worker threads meanwhile. (TOUCH f)
+   waits for the value of the future f and returns it; the builtin functions
+   (except CONS and LIST) and the tests of COND, AND and OR touch the futures
+   they are given by themselves, so a future can mostly be used in place of
+   its value. A future is touched in the context that created it, but it is
+   evaluated elsewhere, so x is evaluated in a copy of the creating context
+   taken by FUTURE (clonectx): the copy holds the values that the variables
+   free in x have at that moment, whatever shallow bindings are undone or
+   assignments made in the creator afterwards. Assignments made by x are lost.
+   The value is handed back like the results of PMAP (xencode, xdecode), as
+   is the output printed by x, when the future is touched the first time. An
+   error in x is signaled again by every touch.
+
+   Every pool worker has a deque of futures: the futures created by a worker
+   are pushed onto its own deque and the others are dealt out round robin. A
+   worker runs the future most recently pushed onto its deque, and when its
+   deque is empty it steals the oldest future of another deque. A touch of a
+   future that no worker has started runs it in the touching thread, so a
+   worker waiting for a future it created never waits for a busy pool. One
+   lock guards the deques and the states of the futures; the time it is held
+   is small beside the copy of the context every future takes. */
+
+#define FUTQ 1024   /* the capacity of a deque */
+
+struct Future {
+    int16 state;        /* FUT_QUEUED, FUT_RUNNING or FUT_DONE */
+    int16 refs;         /* Ftab slots and deque entries referring to the future */
+    int16 failed, printed;
+    struct Lispctx *c;  /* the context x is evaluated in, until it is done */
+    int32 x;
+    struct Xbuf res;    /* the encoded value */
+    char *out;          /* what x printed */
+    size_t outlen;
+    char msg[80];       /* the error message if failed */
+};
+#define FUT_QUEUED  0
+#define FUT_RUNNING 1
+#define FUT_DONE    2
+
+struct Futdeque {struct Future *q[FUTQ]; long top, bot;};
+
+pthread_mutex_t futlock=PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t futwork=PTHREAD_COND_INITIALIZER;    /* a future was pushed */
+pthread_cond_t futdone=PTHREAD_COND_INITIALIZER;    /* a future is done */
+struct Futdeque *fdq;   /* one deque per worker */
+int nfw;                /* the number of workers, 0 until the first FUTURE */
+long fdeal;             /* the next deque to deal a future to */
+__thread int fwid=-1;   /* the index of the worker running in this thread */
+
+void futrelease(struct Future *f)
+/* drops a reference to f, and frees f with the last one */
+{
+    int16 k;
+
+    pthread_mutex_lock(&futlock);
+    k=--f->refs;
+    pthread_mutex_unlock(&futlock);
+    if (k > 0) return;
+    if (f->c != NULL) freectx(f->c);
+    free(f->res.b);
+    free(f->out);
+    free(f);
+}
+
+void futretain(struct Lispctx *cx)
+/* cx has been copied from another context: count its references */
+{
+    int32 i;
+
+    pthread_mutex_lock(&futlock);
+    for (i=0; i<NFUT; i++)
+        if (cx->Ftab[i].f != NULL) cx->Ftab[i].f->refs++;
+    pthread_mutex_unlock(&futlock);
+}
+
+void futdrop(struct Lispctx *cx)
+/* cx is freed: drop its references */
+{
+    int32 i;
+
+    for (i=0; i<NFUT; i++)
+        if (cx->Ftab[i].f != NULL) {futrelease(cx->Ftab[i].f); cx->Ftab[i].f=NULL;}
+}
+
+void futsweep(struct Lispctx *cx)
+/* called by gc(): frees the slots of the futures that were not marked */
+{
+    int32 i;
+
+    for (i=0; i<NFUT; i++)
+    {
+        if (cx->Ftab[i].f != NULL && !cx->fmark[i])
+        {
+            futrelease(cx->Ftab[i].f);
+            cx->Ftab[i].f=NULL;
+        }
+        cx->fmark[i]=0;
+    }
+}
+
+void runfuture(struct Future *f)
+/*-------------------------------------------------
+  Evaluates the expression of f, which the caller
+  has claimed by setting its state to FUT_RUNNING,
+  in its own context, and encodes the value.
+-------------------------------------------------*/
+{
+    struct Lispctx *cx=f->c;
+    volatile size_t keep=0;     /* assigned once error() has jumped back */
+
+    cx->inworker=1;
+    cx->outfp=open_memstream(&f->out, &f->outlen);
+    if (setjmp(cx->env) EQ 0)
+    {
+        skp=newloc(cx, seval(cx, f->x), skp);   /* xencode may touch futures */
+        xencode(cx, &f->res, A(skp));
+    }
+    else
+    {   /* leave out the "::message" error() has printed, the touch signals it again */
+        f->failed=1;
+        strcpy(f->msg, cx->errmsg);
+        fflush(cx->outfp);
+        keep=(f->outlen > strlen(cx->errmsg)+3)? f->outlen-(strlen(cx->errmsg)+3) : 0;
+    }
+    fclose(cx->outfp);  /* this sets outlen again */
+    if (f->failed) f->outlen=keep;
+    freectx(cx);
+    f->c=NULL;
+
+    pthread_mutex_lock(&futlock);
+    f->state=FUT_DONE;
+    pthread_cond_broadcast(&futdone);
+    pthread_mutex_unlock(&futlock);
+}
+
+struct Future *futtake(int w)
+/*-------------------------------------------------
+  Returns the next future for the worker w to run,
+  newest first from its own deque, or else stolen
+  from another deque, oldest first, together with
+  the reference of its deque entry. Returns NULL if
+  there is none. Called with futlock held. Entries
+  of futures that have been started by a touch are
+  dropped on the way, and so are the futures that
+  nothing else refers to any more.
+-------------------------------------------------*/
+{
+    struct Futdeque *d;
+    struct Future *f;
+    int k;
+
+    for (k=0; k<nfw; k++)
+    {
+        d=&fdq[(w+k)%nfw];
+        while (d->top < d->bot)
+        {
+            if (k EQ 0) f=d->q[--d->bot % FUTQ];
+            else f=d->q[d->top++ % FUTQ];
+            if (f->state EQ FUT_QUEUED && f->refs > 1)
+            {
+                f->state=FUT_RUNNING;
+                return f;
+            }
+            /* futrelease takes the lock, so the entry's reference is dropped here */
+            if (--f->refs EQ 0)
+            {
+                pthread_mutex_unlock(&futlock);
+                if (f->c != NULL) freectx(f->c);
+                free(f->res.b); free(f->out); free(f);
+                pthread_mutex_lock(&futlock);
+            }
+        }
+    }
+    return NULL;
+}
+
+void *futworker(void *arg)
+{
+    struct Future *f;
+
+    fwid=(int)(long)arg;
+    pthread_mutex_lock(&futlock);
+    for (;;)
+    {
+        if ((f=futtake(fwid)) EQ NULL)
+        {
+            pthread_cond_wait(&futwork, &futlock);
+            continue;
+        }
+        pthread_mutex_unlock(&futlock);
+        runfuture(f);
+        futrelease(f);
+        pthread_mutex_lock(&futlock);
+    }
+    return NULL;
+}
+
+void futforklock(void)   { pthread_mutex_lock(&futlock); }
+void futforkunlock(void) { pthread_mutex_unlock(&futlock); }
+
+void futfork(void)
+/* a forked child has none of the workers: start a new pool when needed */
+{
+    pthread_mutex_init(&futlock, NULL);
+    pthread_cond_init(&futwork, NULL);
+    pthread_cond_init(&futdone, NULL);
+    nfw=0;
+}
+
+void startpool(void)
+/* starts the workers, one per processor. Called with futlock held. */
+{
+    long i, k;
+    pthread_t t;
+
+    k=sysconf(_SC_NPROCESSORS_ONLN);
+    if (k < 1) k=1;
+    if (fdq EQ NULL)
+    {
+        fdq=(struct Futdeque *)calloc(k, sizeof(struct Futdeque));
+        pthread_atfork(futforklock, futforkunlock, futfork);
+    }
+    else
+        for (i=0; i<k; i++) fdq[i].top=fdq[i].bot=0;
+    for (i=0; i<k; i++)
+    {
+        pthread_create(&t, NULL, futworker, (void *)i);
+        pthread_detach(t);
+    }
+    nfw=k;
+}
+
+int32 future(struct Lispctx *cx, int32 x)
+/*-------------------------------------------------
+  Returns a new future for the expression x and
+  schedules x for evaluation by the pool.
+-------------------------------------------------*/
+{
+    int32 i;
+    struct Future *f;
+    struct Futdeque *d;
+
+    for (i=0; i<NFUT && cx->Ftab[i].f != NULL; i++) ;
+    if (i EQ NFUT)
+    {   /* collect the futures that are no longer used */
+        gc(cx, GC_CALL);
+        for (i=0; i<NFUT && cx->Ftab[i].f != NULL; i++) ;
+        if (i EQ NFUT) error(cx, "too many futures");
+    }
+
+    f=(struct Future *)calloc(1, sizeof(struct Future));
+    f->x=x;
+    f->c=clonectx(cx);
+    f->refs=2;  /* the slot and the deque entry */
+    cx->Ftab[i].f=f;
+    cx->Ftab[i].v=-1;
+
+    pthread_mutex_lock(&futlock);
+    if (nfw EQ 0) startpool();
+    d=&fdq[(fwid >= 0 && fwid < nfw)? fwid : fdeal++ % nfw];
+    if (d->bot-d->top < FUTQ)
+    {
+        d->q[d->bot++ % FUTQ]=f;
+        pthread_cond_signal(&futwork);
+        f=NULL;
+    }
+    else
+    {   /* the deque is full: evaluate x now */
+        f->state=FUT_RUNNING;
+        f->refs--;
+    }
+    pthread_mutex_unlock(&futlock);
+    if (f != NULL) runfuture(f);
+    return tp(0x20000000, i);
+}
+
+int32 touch(struct Lispctx *cx, int32 v)
+/*-------------------------------------------------
+  Returns the value of v if it is a future,
+  waiting for it or evaluating it if necessary,
+  and v itself otherwise.
+-------------------------------------------------*/
+{
+    int32 i;
+    char *bp;
+    struct Future *f;
+    int16 run, print;
+
+    if (type(v) != 2) return v;
+    i=ptrv(v);
+    if (cx->Ftab[i].v != -1) return cx->Ftab[i].v;
+    f=cx->Ftab[i].f;
+
+    pthread_mutex_lock(&futlock);
+    if ((run=(f->state EQ FUT_QUEUED))) f->state=FUT_RUNNING;
+    else while (f->state != FUT_DONE) pthread_cond_wait(&futdone, &futlock);
+    pthread_mutex_unlock(&futlock);
+    if (run) runfuture(f);
+
+    pthread_mutex_lock(&futlock);
+    if ((print=!f->printed)) f->printed=1;
+    pthread_mutex_unlock(&futlock);
+    if (print)
+    {
+        fwrite(f->out, 1, f->outlen, cx->outfp);
+        if (cx->logfilep != NULL) fwrite(f->out, 1, f->outlen, cx->logfilep);
+    }
+    if (f->failed) error(cx, f->msg);
+
+    /* protect the future while its value is built */
+    skp=newloc(cx, v, skp);
+    bp=f->res.b;
+    cx->Ftab[i].v=xdecode(cx, &bp);
+    skp=B(skp);
+    return cx->Ftab[i].v;
+}
+
+/* VECTORS:
+   A vector is a header in Vtab and a contiguous block of words in the vector
+   store Vs, so that indexing it costs the same whatever the index. Every block
+   starts with two words, the index of its header and the number of words in
+   the block, followed by the elements; blocks are allocated from the top of
+   the store and have an even number of words. gc() marks the headers reached
+   and then slides the blocks of the marked ones down over the others
+   (vsweep), so the free space is always the top of the store. The base of a
+   vector therefore changes with every collection: it must be fetched again
+   after anything that may allocate. */
+int32 newvec(struct Lispctx *cx, char kind, int32 len)
+/*-------------------------------------------------
+  Returns a typed pointer to a new vector of len
+  elements of the given kind, all NIL or 0. len
+  counts bytes for VK_BYTES.
+-------------------------------------------------*/
+{
+    int32 i, j, k, tries;
+
+    k=2+((kind EQ VK_F64)? 2*len : (kind EQ VK_BYTES)? (len+3)/4 : len);
+    k+=k&1;     /* so that every block, and every vector of doubles, starts at an even word */
+    for (tries=0; ; tries++)
+    {
+        for (i=0; i<NVEC && cx->Vtab[i].len >= 0; i++) ;
+        if (i<NVEC && k <= VWORDS-cx->vtop) break;
+        if (tries>0) error(cx, "vector space exhausted");
+        gc(cx, GC_CALL);
+    }
+    cx->Vs[cx->vtop]=i;
+    cx->Vs[cx->vtop+1]=k;
+    cx->Vtab[i].base=cx->vtop+2;
+    cx->Vtab[i].len=len;
+    cx->Vtab[i].kind=kind;
+    if (kind EQ VK_OBJ)
+        for (j=0; j<len; j++) cx->Vs[cx->vtop+2+j]=cx->nilptr;
+    else
+        memset(&cx->Vs[cx->vtop+2], 0, (k-2)*sizeof(int32));
+    cx->vtop+=k;
+    return tp(0x30000000, i);
+}
+
+int32 vindex(struct Lispctx *cx, int32 v, int32 x, char *who)
+/* returns the number x as an index of the vector v, or signals an error for who */
+{
+    double d;
+
+    if (type(v) != 3)
+    {
+        sprintf(cx->sout, "%s application: the first argument is not a vector", who);
+        error(cx, cx->sout);
+    }
+    if (type(x) != 9 || (d=cx->Ntab[ptrv(x)].num) < 0 || d >= cx->Vtab[ptrv(v)].len || d != floor(d))
+    {
+        sprintf(cx->sout, "%s application: illegal index", who);
+        error(cx, cx->sout);
+    }
+    return (int32)d;
+}
+
+int32 vcount(struct Lispctx *cx, int32 x, int32 lim, char *who, char *what)
+/* returns the number x as a length, size or index from 0 to lim, or signals an error for who */
+{
+    double d;
+
+    if (type(x) != 9 || (d=cx->Ntab[ptrv(x)].num) < 0 || d > lim || d != floor(d))
+    {
+        sprintf(cx->sout, "%s application: illegal %s", who, what);
+        error(cx, cx->sout);
+    }
+    return (int32)d;
+}
+
+void vsweep(struct Lispctx *cx)
+/* called by gc(): frees the unmarked vectors and compacts the store */
+{
+    int32 i, k, h, top=0;
+
+    for (i=0; i<cx->vtop; i+=k)
+    {
+        h=cx->Vs[i];
+        k=cx->Vs[i+1];
+        if (!cx->vmark[h]) continue;
+        if (top != i) memmove(&cx->Vs[top], &cx->Vs[i], k*sizeof(int32));
+        cx->Vtab[h].base=top+2;
+        top+=k;
+    }
+    cx->vtop=top;
+    for (i=0; i<NVEC; i++)
+    {
+        if (!cx->vmark[i]) cx->Vtab[i].len=-1;
+        cx->vmark[i]=0;
+    }
+}
+
+/* VECTORS OF DOUBLES:
+   (MAKE-DVECTOR n x) and (LIST-TO-DVECTOR lst) make vectors that hold their
+   elements as raw doubles instead of typed pointers to the number table, so
+   numeric work on them neither looks up nor interns a number per element.
+   VSUM, VPRODUCT, VMIN and VMAX reduce a vector to a number, (VDOT v w) is
+   the dot product, and (V+ v w) and (V* v w) return the elementwise sum and
+   product as a new vector.
+
+   The kernels are written once, on the GCC vector extension type of four
+   doubles, and compiled for AVX, for SSE2 and for no particular CPU; the
+   first use picks the variant the CPU supports. All the variants do the
+   same arithmetic in the same order: a reduction keeps eight partial
+   results, where the partial result j takes in the elements 8i+j, combines
+   them pairwise as ((0,1),(2,3)),((4,5),(6,7)) and then takes in the last
+   n mod 8 elements in order. So every variant gives the same bits on the
+   same data, and V+ and V* are exact anyway. Compared with a left-to-right
+   sum, like SUM computes on a list, VSUM and VDOT can differ within the
+   usual bound of either: n times the machine epsilon times the sum of the
+   magnitudes of the terms. If the compiler is allowed to contract a
+   multiplication and an addition into an FMA instruction (-ffp-contract=fast
+   on a target with FMA), VDOT may also differ between the variants, within
+   the same bound. VMIN and VMAX are exact for vectors without NaNs. */
+
+typedef double v4d __attribute__((vector_size(32)));
+typedef long long v4l __attribute__((vector_size(32)));
+
+#define DVPICK(op,a,b)  (((op) EQ DV_MIN)? (((a)<(b))? (a) : (b)) : (((a)>(b))? (a) : (b)))
+#define V4(p)           ({v4d v_; memcpy(&v_, (p), sizeof(v4d)); v_;})  /* an unaligned load */
+#define DVPICK4(op,a,b) ({v4d a_=(a), b_=(b); v4l lt_=((op) EQ DV_MIN)? (a_<b_) : (a_>b_); \
+                          (v4d)(((v4l)a_ & lt_) | ((v4l)b_ & ~lt_));})
+
+static inline __attribute__((always_inline))
+double dvreduce8(int16 op, double *x, double *y, long k)
+/*-------------------------------------------------
+  The reduction op of the k elements of x (and y),
+  k>0 for DV_MIN and DV_MAX. The eight partial
+  results are the lanes of a0 (0-3) and a1 (4-7).
+-------------------------------------------------*/
+{
+    v4d a0, a1;
+    double r[8], s;
+    long i=0;
+
+    if ((op EQ DV_MIN || op EQ DV_MAX) && k<8)
+    {
+        for (s=x[0], i=1; i<k; i++) s=DVPICK(op, s, x[i]);
+        return s;
+    }
+    s=(op EQ DV_PROD)? 1.0 : 0.0;
+    a0=a1=(v4d){s, s, s, s};
+    switch (op)
+    {
+        case DV_SUM:
+            for (; i+8<=k; i+=8) {a0+=V4(x+i); a1+=V4(x+i+4);}
+            break;
+        case DV_PROD:
+            for (; i+8<=k; i+=8) {a0*=V4(x+i); a1*=V4(x+i+4);}
+            break;
+        case DV_DOT:
+            for (; i+8<=k; i+=8) {a0+=V4(x+i)*V4(y+i); a1+=V4(x+i+4)*V4(y+i+4);}
+            break;
+        default:    /* DV_MIN, DV_MAX */
+            a0=V4(x); a1=V4(x+4);
+            for (i=8; i+8<=k; i+=8) {a0=DVPICK4(op, a0, V4(x+i)); a1=DVPICK4(op, a1, V4(x+i+4));}
+    }
+    memcpy(r, &a0, sizeof(v4d));
+    memcpy(r+4, &a1, sizeof(v4d));
+
+    switch (op)
+    {
+        case DV_SUM:
+            s=((r[0]+r[1])+(r[2]+r[3]))+((r[4]+r[5])+(r[6]+r[7]));
+            for (; i<k; i++) s+=x[i];
+            break;
+        case DV_PROD:
+            s=((r[0]*r[1])*(r[2]*r[3]))*((r[4]*r[5])*(r[6]*r[7]));
+            for (; i<k; i++) s*=x[i];
+            break;
+        case DV_DOT:
+            s=((r[0]+r[1])+(r[2]+r[3]))+((r[4]+r[5])+(r[6]+r[7]));
+            for (; i<k; i++) s+=x[i]*y[i];
+            break;
+        default:
+            s=DVPICK(op, DVPICK(op, DVPICK(op, r[0], r[1]), DVPICK(op, r[2], r[3])),
+                         DVPICK(op, DVPICK(op, r[4], r[5]), DVPICK(op, r[6], r[7])));
+            for (; i<k; i++) s=DVPICK(op, s, x[i]);
+    }
+    return s;
+}
+
+static inline __attribute__((always_inline))
+void dvmap8(int16 op, double *x, double *y, double *z, long k)
+/* z = x+y or z = x*y, elementwise */
+{
+    v4d a;
+    long i=0;
+
+    if (op EQ DV_ADD)
+        for (; i+4<=k; i+=4) {a=V4(x+i)+V4(y+i); memcpy(z+i, &a, sizeof(v4d));}
+    else
+        for (; i+4<=k; i+=4) {a=V4(x+i)*V4(y+i); memcpy(z+i, &a, sizeof(v4d));}
+    for (; i<k; i++) z[i]=(op EQ DV_ADD)? x[i]+y[i] : x[i]*y[i];
+}
+
+double dvreduce_c(int16 op, double *x, double *y, long k) {return dvreduce8(op, x, y, k);}
+void dvmap_c(int16 op, double *x, double *y, double *z, long k) {dvmap8(op, x, y, z, k);}
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse2")))
+double dvreduce_sse2(int16 op, double *x, double *y, long k) {return dvreduce8(op, x, y, k);}
+__attribute__((target("sse2")))
+void dvmap_sse2(int16 op, double *x, double *y, double *z, long k) {dvmap8(op, x, y, z, k);}
+__attribute__((target("avx")))
+double dvreduce_avx(int16 op, double *x, double *y, long k) {return dvreduce8(op, x, y, k);}
+__attribute__((target("avx")))
+void dvmap_avx(int16 op, double *x, double *y, double *z, long k) {dvmap8(op, x, y, z, k);}
+#endif
+
+struct Dvkernels {
+    char *isa;
+    double (*reduce)(int16 op, double *x, double *y, long k);
+    void (*map)(int16 op, double *x, double *y, double *z, long k);
+} dvk;
+pthread_once_t dvonce=PTHREAD_ONCE_INIT;
+
+void dvselect(void)
+/* picks the kernels for this CPU, once per process */
+{
+    dvk.isa="scalar"; dvk.reduce=dvreduce_c; dvk.map=dvmap_c;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx"))
+        {dvk.isa="avx"; dvk.reduce=dvreduce_avx; dvk.map=dvmap_avx;}
+    else if (__builtin_cpu_supports("sse2"))
+        {dvk.isa="sse2"; dvk.reduce=dvreduce_sse2; dvk.map=dvmap_sse2;}
+#endif
+}
+
+double *dvec(struct Lispctx *cx, int32 v, char *who)
+/* returns the elements of the vector of doubles v, or signals an error for who */
+{
+    if (type(v) != 3 || cx->Vtab[ptrv(v)].kind != VK_F64)
+    {
+        sprintf(cx->sout, "%s application: the argument is not a vector of doubles", who);
+        error(cx, cx->sout);
+    }
+    return Vd(ptrv(v));
+}
+
+int32 dvreduce(struct Lispctx *cx, int16 op, int32 v, int32 w)
+/* the number the reduction op makes of the vector v, and of w for DV_DOT */
+{
+    static char *who[]={"VSUM", "VPRODUCT", "VMIN", "VMAX", "VDOT"};
+    double *x, *y=NULL;
+    long k;
+
+    pthread_once(&dvonce, dvselect);
+    x=dvec(cx, v, who[op]);
+    k=cx->Vtab[ptrv(v)].len;
+    if (op EQ DV_DOT)
+    {
+        y=dvec(cx, w, who[op]);
+        if (cx->Vtab[ptrv(w)].len != k) error(cx, "VDOT application: the vectors differ in length");
+    }
+    if (k EQ 0 && (op EQ DV_MIN || op EQ DV_MAX))
+    {
+        sprintf(cx->sout, "%s application: the vector is empty", who[op]);
+        error(cx, cx->sout);
+    }
+    return numatom(cx, dvk.reduce(op, x, y, k));
+}
+
+int32 dvmap(struct Lispctx *cx, int16 op, int32 v, int32 w)
+/* the new vector of the elementwise sums (DV_ADD) or products (DV_MUL) of v and w */
+{
+    char *who=(op EQ DV_ADD)? "V+" : "V*";
+    int32 z;
+    long k;
+
+    pthread_once(&dvonce, dvselect);
+    dvec(cx, v, who);
+    dvec(cx, w, who);
+    if ((k=cx->Vtab[ptrv(v)].len) != cx->Vtab[ptrv(w)].len)
+    {
+        sprintf(cx->sout, "%s application: the vectors differ in length", who);
+        error(cx, cx->sout);
+    }
+    z=newvec(cx, VK_F64, k);    /* v and w are kept by eaL, but may move */
+    dvk.map(op, Vd(ptrv(v)), Vd(ptrv(w)), Vd(ptrv(z)), k);
+    return z;
+}
+
+/* HASH TABLES:
+   (MAKE-HASH) makes a hash table, (PUTHASH h key value) enters value under
+   key, (GETHASH h key) returns it, or NIL, and (REMHASH h key) removes it.
+   Keys are compared with EQ, so atoms, numbers (which are unique in the
+   number table) and list cells can be keys, and a key is hashed by its typed
+   pointer, which does not change while the key is reachable. Big integers are
+   EQ when they are equal, not only when they are the same entry of Btab, so
+   they are hashed by their limbs and compared with numcmp. (MAPHASH f h)
+   applies f to every key and its value, (HASH-KEYS h) returns the keys and
+   (HASH-COUNT h) the number of entries.
+
+   The table is open addressed with linear probing in a vector of key and
+   value pairs, so gc() marks and moves it like any other vector. A free pair
+   has the key HEMPTY and a removed one HDEAD; both are undefined typed
+   pointers, which gcmark skips and no key can be. When the pairs in use,
+   removed ones included, would exceed 3/4 of the vector, a new vector with
+   room for twice the entries is made and the entries are moved over a few at
+   a time by every later operation on the table (hmigrate), so no single
+   PUTHASH pays for copying the whole table. Until then a key is looked up in
+   both vectors. */
+
+#define HEMPTY      ud(0)
+#define HDEAD       ud(1)
+#define HMIGRATE    16          /* old pairs moved by every operation */
+#define HK(v,i)     cx->Vs[cx->Vtab[v].base+2*(i)]      /* the key of the pair i of the vector v */
+#define HVAL(v,i)   cx->Vs[cx->Vtab[v].base+2*(i)+1]    /* and its value */
+#define hcap(v)     (cx->Vtab[v].len/2)
+
+uint32_t hmix(int32 key)
+{
+    uint32_t x=key;
+    x ^= x>>15;
+    x *= 2654435761u;
+    return x ^ (x>>13);
+}
+
+uint32_t hkey(struct Lispctx *cx, int32 key)
+/* the hash of a key: its typed pointer, or the limbs and sign of a big integer */
+{
+    uint32_t h=0;
+    int32 i, j=ptrv(key);
+
+    if (type(key) != 6) return hmix(key);
+    for (i=0; i<cx->Btab[j].len; i++) h=h*31+Bd(j)[i];
+    return hmix((int32)(h*31+cx->Btab[j].neg));
+}
+
+#define hsame(k,key)    ((k) EQ (key) || (type(key) EQ 6 && type(k) EQ 6 && numcmp(cx, k, key, "EQ") EQ 0))
+
+int32 hvector(struct Lispctx *cx, int32 k)
+/* a new pair vector for at least k entries, all free */
+{
+    int32 c, i, v;
+
+    for (c=8; c*3 < k*4+4; c*=2) ;
+    v=ptrv(newvec(cx, VK_OBJ, 2*c));
+    for (i=0; i<c; i++) HK(v,i)=HEMPTY;
+    return v;
+}
+
+int32 newhash(struct Lispctx *cx, int32 k)
+/* a new, empty hash table with room for k entries */
+{
+    int32 i;
+
+    for (i=0; i<NHASH && cx->Htab[i].nv >= 0; i++) ;
+    if (i EQ NHASH)
+    {
+        gc(cx, GC_CALL);
+        for (i=0; i<NHASH && cx->Htab[i].nv >= 0; i++) ;
+        if (i EQ NHASH) error(cx, "too many hash tables");
+    }
+    cx->Htab[i].ov=-1;  /* no vector of this table is reachable yet */
+    cx->Htab[i].nv=hvector(cx, k);
+    cx->Htab[i].count=cx->Htab[i].used=cx->Htab[i].migr=0;
+    return tp(0x40000000, i);
+}
+
+int32 hashof(struct Lispctx *cx, int32 h, char *who)
+/* returns the Htab index of the hash table h, or signals an error for who */
+{
+    if (type(h) != 4)
+    {
+        sprintf(cx->sout, "%s application: the first argument is not a hash table", who);
+        error(cx, cx->sout);
+    }
+    return ptrv(h);
+}
+
+int32 hfind(struct Lispctx *cx, int32 v, int32 key, int32 *ins)
+/*-------------------------------------------------
+  Returns the pair of key in the vector v, or -1
+  if key is not there. *ins gets the pair key would
+  be entered into: the first removed or free pair
+  on its probe sequence.
+-------------------------------------------------*/
+{
+    int32 c=hcap(v), i, k;
+
+    *ins=-1;
+    for (i=hkey(cx, key)&(c-1); ; i=(i+1)&(c-1))
+    {
+        k=HK(v,i);
+        if (hsame(k, key)) return i;
+        if (k EQ HEMPTY)
+        {
+            if (*ins < 0) *ins=i;
+            return -1;
+        }
+        if (k EQ HDEAD && *ins < 0) *ins=i;
+    }
+}
+
+void hmigrate(struct Lispctx *cx, int32 h, int32 k)
+/* moves the entries of up to k pairs of the old vector of h into the new one */
+{
+    struct Hashtable *t=&cx->Htab[h];
+    int32 key, ins;
+
+    for (; k>0 && t->ov >= 0; k--)
+    {
+        if (t->migr EQ hcap(t->ov))
+        {   /* done: the old vector is garbage now */
+            t->ov=-1;
+            return;
+        }
+        key=HK(t->ov, t->migr);
+        if (key != HEMPTY && key != HDEAD)
+        {
+            hfind(cx, t->nv, key, &ins);
+            if (HK(t->nv, ins) EQ HEMPTY) t->used++;
+            HK(t->nv, ins)=key;
+            HVAL(t->nv, ins)=HVAL(t->ov, t->migr);
+            HK(t->ov, t->migr)=HDEAD;
+        }
+        t->migr++;
+    }
+}
+
+int32 hget(struct Lispctx *cx, int32 h, int32 key)
+/* returns the value of key in the hash table h, or -1 if there is none */
+{
+    int32 i, ins;
+
+    hmigrate(cx, h, HMIGRATE);
+    if ((i=hfind(cx, cx->Htab[h].nv, key, &ins)) >= 0) return HVAL(cx->Htab[h].nv, i);
+    if (cx->Htab[h].ov >= 0 && (i=hfind(cx, cx->Htab[h].ov, key, &ins)) >= 0) return HVAL(cx->Htab[h].ov, i);
+    return -1;
+}
+
+void hput(struct Lispctx *cx, int32 h, int32 key, int32 val)
+/* enters val as the value of key into the hash table h */
+{
+    struct Hashtable *t=&cx->Htab[h];   /* Htab does not move, the vectors do */
+    int32 i, ins, oins;
+
+    hmigrate(cx, h, HMIGRATE);
+    if ((i=hfind(cx, t->nv, key, &ins)) >= 0)
+    {
+        HVAL(t->nv, i)=val;
+        return;
+    }
+    if (t->ov >= 0 && (i=hfind(cx, t->ov, key, &oins)) >= 0)
+    {   /* the entry is moved over now */
+        HK(t->ov, i)=HDEAD;
+        t->count--;
+    }
+    if ((t->used+1)*4 > hcap(t->nv)*3)
+    {   /* start a resize, finishing the last one first; key and val may
+           only be kept by the caller's C variables */
+        hmigrate(cx, h, hcap(t->ov >= 0? t->ov : t->nv)+1);
+        skp=newloc(cx, key, newloc(cx, val, skp));
+        i=hvector(cx, t->count+1);
+        skp=B(B(skp));
+        t->ov=t->nv;
+        t->nv=i;
+        t->used=t->migr=0;
+        hmigrate(cx, h, HMIGRATE);
+        hfind(cx, t->nv, key, &ins);
+    }
+    if (HK(t->nv, ins) EQ HEMPTY) t->used++;
+    HK(t->nv, ins)=key;
+    HVAL(t->nv, ins)=val;
+    t->count++;
+}
+
+int16 hrem(struct Lispctx *cx, int32 h, int32 key)
+/* removes key from the hash table h; returns 0 if it was not there */
+{
+    int32 i, v, ins;
+
+    hmigrate(cx, h, HMIGRATE);
+    v=cx->Htab[h].nv;
+    if ((i=hfind(cx, v, key, &ins)) < 0)
+    {
+        if ((v=cx->Htab[h].ov) < 0 || (i=hfind(cx, v, key, &ins)) < 0) return 0;
+    }
+    HK(v,i)=HDEAD;
+    HVAL(v,i)=cx->nilptr;
+    cx->Htab[h].count--;
+    return 1;
+}
+
+int32 hashkeys(struct Lispctx *cx, int32 h)
+/* returns the list of the keys of the hash table h */
+{
+    int32 i, k, v;
+
+    hmigrate(cx, h, hcap(cx->Htab[h].ov >= 0? cx->Htab[h].ov : cx->Htab[h].nv)+1);
+    skp=newloc(cx, cx->nilptr, skp);
+    for (i=0; i<hcap(cx->Htab[h].nv); i++)
+    {
+        k=HK(cx->Htab[h].nv, i);
+        if (k != HEMPTY && k != HDEAD) A(skp)=newloc(cx, k, A(skp));
+    }
+    v=A(skp);
+    skp=B(skp);
+    return v;
+}
+
+int32 maphash(struct Lispctx *cx, int32 f, int32 h)
+/*-------------------------------------------------
+  Applies f to every key of the hash table h and
+  its value. f may change or remove entries, but
+  entering new keys may start a resize, which is
+  signaled as an error.
+-------------------------------------------------*/
+{
+    int32 i, k, v;
+
+    hmigrate(cx, h, hcap(cx->Htab[h].ov >= 0? cx->Htab[h].ov : cx->Htab[h].nv)+1);
+    v=cx->Htab[h].nv;
+    for (i=0; i<hcap(v); i++)
+    {
+        k=HK(v,i);
+        if (k EQ HEMPTY || k EQ HDEAD) continue;
+        apply2(cx, f, k, HVAL(v,i));
+        if (cx->Htab[h].nv != v) error(cx, "MAPHASH application: the table was resized by the function");
+    }
+    return cx->nilptr;
+}
+
+void hsweep(struct Lispctx *cx)
+/* called by gc(): frees the unmarked hash tables */
+{
+    int32 i;
+
+    for (i=0; i<NHASH; i++)
+    {
+        if (!cx->hmark[i]) cx->Htab[i].nv=-1;
+        cx->hmark[i]=0;
+    }
+}
+
+/* PROPERTIES:
+   The property list of an atom is a list of (property . value) pairs, kept
+   with PUTPLIST and GETPLIST. (GETPROP a p) returns the value of the property
+   p of the atom a, or NIL, (PUTPROP a p v) sets it to v and returns v, and
+   (REMPROP a p) removes it. The list stays the property list, GETPLIST
+   returns it as before, but once it has more than PROPHASH pairs, a hash
+   table from the properties to their pairs is kept in Atab[~].pix, so that
+   GETPROP and PUTPROP do not have to search the list. PUTPLIST drops the
+   index, and so does an index entry that no longer matches its pair; the
+   next access makes a new one. A list that is changed in place with RPLACA
+   or RPLACD should be installed again with PUTPLIST. */
+
+#define PROPHASH 8
+
+int16 hfree(struct Lispctx *cx)
+/* tells whether a hash table can be made without a collection */
+{
+    int32 i;
+
+    for (i=0; i<NHASH; i++)
+        if (cx->Htab[i].nv < 0) return 1;
+    return 0;
+}
+
+int32 propscan(struct Lispctx *cx, int32 a, int32 p, int32 *k)
+/* returns the pair of p in the property list of a, or -1; *k gets the number of pairs looked at */
+{
+    int32 t;
+
+    for (*k=0, t=cx->Atab[a].plist; dottedpair(type(t)); t=B(t))
+        if (dottedpair(type(A(t))))
+        {
+            ++*k;
+            if (A(A(t)) EQ p) return A(t);
+        }
+    return -1;
+}
+
+void propindex(struct Lispctx *cx, int32 a, int32 k)
+/* makes the index of the property list of a, which has k pairs */
+{
+    int32 t, h;
+
+    if (!hfree(cx)) return;   /* the list alone will do */
+    cx->Atab[a].pix=newhash(cx, k);
+    h=ptrv(cx->Atab[a].pix);
+    for (t=cx->Atab[a].plist; dottedpair(type(t)); t=B(t))
+        if (dottedpair(type(A(t))) && hget(cx, h, A(A(t))) EQ -1)
+            hput(cx, h, A(A(t)), A(t));
+}
+
+int32 getprop(struct Lispctx *cx, int32 a, int32 p)
+/* returns the (p . value) pair in the property list of the atom a, or -1 */
+{
+    int32 c, k;
+
+    if (cx->Atab[a].pix != cx->nilptr)
+    {
+        c=hget(cx, ptrv(cx->Atab[a].pix), p);
+        if (c EQ -1 || A(c) EQ p) return c;
+        cx->Atab[a].pix=cx->nilptr;     /* the pair has been changed in place */
+    }
+    c=propscan(cx, a, p, &k);
+    if (k > PROPHASH && cx->Atab[a].pix EQ cx->nilptr) propindex(cx, a, k);
+    return c;
+}
+
+int32 putprop(struct Lispctx *cx, int32 a, int32 p, int32 v)
+/* sets the property p of the atom a to v */
+{
+    int32 c;
+
+    if ((c=getprop(cx, a, p)) != -1)
+    {
+        setcdr(cx, c, v);   /* c is kept by the property list */
+        return v;
+    }
+    /* p and v are kept by the caller's eaL */
+    c=newloc(cx, p, v);
+    cx->Atab[a].plist=newloc(cx, c, cx->Atab[a].plist);
+    if (cx->Atab[a].pix != cx->nilptr) hput(cx, ptrv(cx->Atab[a].pix), p, c);
+    return v;
+}
+
+int16 remprop(struct Lispctx *cx, int32 a, int32 p)
+/* removes the property p of the atom a; returns 0 if there was none */
+{
+    int32 t, u=-1;
+
+    for (t=cx->Atab[a].plist; dottedpair(type(t)); u=t, t=B(t))
+        if (dottedpair(type(A(t))) && A(A(t)) EQ p)
+        {
+            if (u < 0) cx->Atab[a].plist=B(t);
+            else setcdr(cx, u, B(t));   /* u is kept by the property list */
+            if (cx->Atab[a].pix != cx->nilptr) hrem(cx, ptrv(cx->Atab[a].pix), p);
+            return 1;
+        }
+    return 0;
+}
+
+/* STRINGS:
+   "..." reads a string, in which \" and \\ stand for " and \ and \n for a
+   newline. The bytes of strings live in VK_BYTES vectors of the vector store,
+   so that they are moved and reclaimed by the collector like those of
+   vectors; a string itself is only a header in Stab that tells which bytes of
+   which vector are its own. (SUBSTR s i j), which returns the bytes i to j-1
+   of s, therefore copies nothing: the new string shares the vector of s.
+   (STRCAT s t) copies both into a new vector, (STRCMP s t) returns -1, 0 or 1
+   as s sorts before, equal to or after t, and (STRSEARCH s t) the index of
+   the first t in s, or NIL. (STRING x) returns the name of an atom or the
+   printed form of a number as a string, (INTERN s) the atom named s, and
+   (STRLEN s) the number of bytes in s. */
+
+int32 newstr(struct Lispctx *cx, int32 len)
+/* returns a typed pointer to a new string of len bytes, all 0 */
+{
+    int32 i, tries, b;
+
+    for (tries=0; ; tries++)
+    {
+        for (i=0; i<NSTR && cx->Stab[i].buf >= 0; i++) ;
+        if (i<NSTR) break;
+        if (tries>0) error(cx, "string table is full");
+        gc(cx, GC_CALL);
+    }
+    /* a collection in newvec() leaves the free header i free */
+    b=newvec(cx, VK_BYTES, len);
+    cx->Stab[i].buf=ptrv(b);
+    cx->Stab[i].off=0;
+    cx->Stab[i].len=len;
+    return tp(0x50000000, i);
+}
+
+int32 strof(struct Lispctx *cx, int32 x, char *who)
+/* returns the Stab index of the string x, or signals an error for who */
+{
+    if (type(x) != 5)
+    {
+        sprintf(cx->sout, "%s application: a string expected", who);
+        error(cx, cx->sout);
+    }
+    return ptrv(x);
+}
+
+int32 readstr(struct Lispctx *cx)
+/* called by e() after the opening "; reads the rest of a string */
+{
+    int32 c, k=0, size=64, t;
+    char *b=(char *)malloc(size);
+
+    while ((c=getgchar(cx)) != '"')
+    {
+        if (c EQ EOS) {free(b); error(cx, "unterminated string");}
+        if (c EQ '\\')
+        {
+            if ((c=getgchar(cx)) EQ EOS) {free(b); error(cx, "unterminated string");}
+            if (c EQ 'n') c='\n';
+        }
+        if (k EQ size) b=(char *)realloc(b, size*=2);
+        b[k++]=c;
+    }
+    t=newstr(cx, k);
+    memcpy(Sb(ptrv(t)), b, k);
+    free(b);
+    return t;
+}
+
+void writestr(struct Lispctx *cx, int32 j)
+/* prints the string j between quotes, the way e() reads it */
+{
+    int32 i, k=0;
+    char c, *s=Sb(j);   /* printing does not allocate */
+
+    ourprint(cx, "\"");
+    for (i=0; i<cx->Stab[j].len; i++)
+    {
+        if (k >= 76) {cx->sout[k]=EOS; ourprint(cx, cx->sout); k=0;}
+        c=s[i];
+        if (c EQ '"' || c EQ '\\') cx->sout[k++]='\\';
+        if (c EQ '\n') {cx->sout[k++]='\\'; c='n';}
+        cx->sout[k++]=c;
+    }
+    cx->sout[k]=EOS;
+    ourprint(cx, cx->sout);
+    ourprint(cx, "\"");
+}
+
+int32 substr(struct Lispctx *cx, int32 x, int32 i, int32 j)
+/* returns the bytes i to j-1 of the string x as a string sharing them */
+{
+    int32 s=ptrv(x), t, k;
+
+    if (i < 0 || j < i || j > cx->Stab[s].len) error(cx, "SUBSTR application: illegal index");
+    for (k=0; k<NSTR && cx->Stab[k].buf >= 0; k++) ;
+    if (k EQ NSTR)
+    {
+        t=newstr(cx, 0);    /* collects; x is kept by the caller */
+        k=ptrv(t);
+    }
+    cx->Stab[k].buf=cx->Stab[s].buf;
+    cx->Stab[k].off=cx->Stab[s].off+i;
+    cx->Stab[k].len=j-i;
+    return tp(0x50000000, k);
+}
+
+int32 strcat2(struct Lispctx *cx, int32 x, int32 y)
+/* returns a new string of the bytes of x followed by those of y */
+{
+    int32 a=strof(cx, x, "STRCAT"), b=strof(cx, y, "STRCAT"), t;
+
+    /* x and y are kept by the caller; the bytes are fetched after the allocation */
+    t=newstr(cx, cx->Stab[a].len+cx->Stab[b].len);
+    memcpy(Sb(ptrv(t)), Sb(a), cx->Stab[a].len);
+    memcpy(Sb(ptrv(t))+cx->Stab[a].len, Sb(b), cx->Stab[b].len);
+    return t;
+}
+
+int32 strcmp2(struct Lispctx *cx, int32 x, int32 y)
+/* compares the strings x and y byte by byte */
+{
+    int32 a=strof(cx, x, "STRCMP"), b=strof(cx, y, "STRCMP"), k, c;
+
+    k=(cx->Stab[a].len < cx->Stab[b].len)? cx->Stab[a].len : cx->Stab[b].len;
+    if ((c=memcmp(Sb(a), Sb(b), k)) EQ 0) c=cx->Stab[a].len-cx->Stab[b].len;
+    return (c<0)? -1 : (c>0)? 1 : 0;
+}
+
+int32 strsearch(struct Lispctx *cx, int32 x, int32 y)
+/* returns the index of the first y in x, or -1 */
+{
+    int32 a=strof(cx, x, "STRSEARCH"), b=strof(cx, y, "STRSEARCH"), i, k=cx->Stab[b].len;
+    char *s=Sb(a), *t=Sb(b), *p;
+
+    if (k EQ 0) return 0;
+    for (i=0; i <= cx->Stab[a].len-k; i=p-s+1)
+    {
+        if ((p=memchr(s+i, t[0], cx->Stab[a].len-k+1-i)) EQ NULL) return -1;
+        if (memcmp(p, t, k) EQ 0) return p-s;
+    }
+    return -1;
+}
+
+int32 strconv(struct Lispctx *cx, int32 x)
+/* returns the name of the atom x, or the printed form of the number x, as a string */
+{
+    int32 t;
+    char b[32], *s;
+
+    switch (type(x))
+    {
+        case 5: return x;
+        case 8: case 10: case 11: case 12: case 13:
+            s=cx->Atab[ptrv(x)].name; break;
+        case 9:
+            numstr(cx->Ntab[ptrv(x)].num, b); s=b; break;
+        case 6:
+            s=bigstr(cx, ptrv(x));
+            t=newstr(cx, strlen(s));
+            memcpy(Sb(ptrv(t)), s, strlen(s));
+            free(s);
+            return t;
+        default: error(cx, "STRING application: an atom or a number expected");
+    }
+    t=newstr(cx, strlen(s));
+    memcpy(Sb(ptrv(t)), s, strlen(s));
+    return t;
+}
+
+void ssweep(struct Lispctx *cx)
+/* called by gc(): frees the unmarked strings */
+{
+    int32 i;
+
+    for (i=0; i<NSTR; i++)
+    {
+        if (!cx->smark[i]) cx->Stab[i].buf=-1;
+        cx->smark[i]=0;
+    }
+}
+
+/* INTEGERS:
+   A number is a double in the number table, which holds every integer up to
+   IMAX exactly, and so do PLUS, DIFFERENCE, TIMES and QUOTIENT of two such
+   integers as long as the result stays below IMAX. A result that does not
+   becomes a big integer (type 6): a sign and a magnitude of 32-bit limbs in a
+   VK_LIMBS vector, which the collector moves and frees like other vectors.
+   Big integers are not kept in the number table; EQ compares them by value.
+   Arithmetic with a big integer stays exact as long as both arguments are
+   integers, and a result that fits in IMAX is a number again, so that every
+   integer has one representation. QUOTIENT is exact when the division is; if
+   it leaves a remainder, or an argument is not an integer, the arithmetic is
+   that of doubles, as before. e() reads an integer literal of IMAX or more
+   digit by digit, and swrite writes every integer in full, so that they read
+   back as the same integer. */
+
+struct Bn {int32 len; int16 neg; uint32_t *d; uint32_t sd[2];};    /* an integer operand */
+
+void numstr(double d, char *b)
+/* writes the number d into b the way swrite prints it */
+{
+    if (d EQ floor(d) && fabs(d) <= IMAX) sprintf(b, "%.0f", d);
+    else sprintf(b, "%-g", d);
+}
+
+int16 exact(struct Lispctx *cx, int32 x, int64_t *k)
+/* tells whether x is an integer of the number table, and puts it in *k */
+{
+    double d;
+
+    if (type(x) != 9) return 0;
+    d=cx->Ntab[ptrv(x)].num;
+    if (d != floor(d) || fabs(d) > IMAX) return 0;
+    *k=(int64_t)d;
+    return 1;
+}
+
+double numval(struct Lispctx *cx, int32 x, char *who)
+/* returns the number x as a double, or signals an error for who */
+{
+    int32 i, j;
+    double d;
+
+    if (type(x) EQ 9) return cx->Ntab[ptrv(x)].num;
+    if (type(x) != 6)
+    {
+        sprintf(cx->sout, "%s application: a number expected", who);
+        error(cx, cx->sout);
+    }
+    j=ptrv(x);
+    for (d=0.0, i=cx->Btab[j].len-1; i>=0; i--) d=d*4294967296.0+Bd(j)[i];
+    return cx->Btab[j].neg? -d : d;
+}
+
+int16 bnof(struct Lispctx *cx, int32 x, struct Bn *b)
+/* makes b the integer x, if x is one; b->d is only valid until the next allocation */
+{
+    int64_t k;
+    uint64_t u;
+
+    if (type(x) EQ 6)
+    {
+        b->len=cx->Btab[ptrv(x)].len;
+        b->neg=cx->Btab[ptrv(x)].neg;
+        b->d=Bd(ptrv(x));
+        return 1;
+    }
+    if (!exact(cx, x, &k)) return 0;
+    b->neg=(k<0);
+    u=b->neg? -k : k;
+    b->sd[0]=(uint32_t)u;
+    b->sd[1]=(uint32_t)(u>>32);
+    b->len=b->sd[1]? 2 : b->sd[0]? 1 : 0;
+    b->d=b->sd;
+    return 1;
+}
+
+int32 newbig(struct Lispctx *cx, int32 len)
+/* returns a typed pointer to a new big integer of len limbs, all 0 */
+{
+    int32 i, tries, b;
+
+    for (tries=0; ; tries++)
+    {
+        for (i=0; i<NBIG && cx->Btab[i].buf >= 0; i++) ;
+        if (i<NBIG) break;
+        if (tries>0) error(cx, "big integer table is full");
+        gc(cx, GC_CALL);
+    }
+    /* a collection in newvec() leaves the free header i free */
+    b=newvec(cx, VK_LIMBS, len);
+    cx->Btab[i].buf=ptrv(b);
+    cx->Btab[i].len=len;
+    cx->Btab[i].neg=0;
+    return tp(0x60000000, i);
+}
+
+int32 bnresult(struct Lispctx *cx, int16 neg, uint32_t *d, int32 len)
+/* returns the integer of sign neg and the len limbs d, which it frees */
+{
+    uint64_t u;
+    int32 t;
+
+    while (len>0 && d[len-1] EQ 0) len--;
+    if (len <= 2)
+    {
+        u=(len EQ 0)? 0 : (len EQ 1)? d[0] : d[0] | (uint64_t)d[1]<<32;
+        if (u <= (uint64_t)IMAX)
+        {
+            free(d);
+            return numatom(cx, neg? -(double)u : (double)u);
+        }
+    }
+    t=newbig(cx, len);
+    cx->Btab[ptrv(t)].neg=neg;
+    memcpy(Bd(ptrv(t)), d, len*sizeof(uint32_t));
+    free(d);
+    return t;
+}
+
+int16 bncmpmag(struct Bn *a, struct Bn *b)
+/* compares the magnitudes of a and b */
+{
+    int32 i;
+
+    if (a->len != b->len) return (a->len < b->len)? -1 : 1;
+    for (i=a->len-1; i>=0; i--)
+        if (a->d[i] != b->d[i]) return (a->d[i] < b->d[i])? -1 : 1;
+    return 0;
+}
+
+int32 bnaddmag(uint32_t *r, struct Bn *a, struct Bn *b)
+/* r gets |a|+|b|; returns its length */
+{
+    int32 i, k=(a->len > b->len)? a->len : b->len;
+    uint64_t c=0;
+
+    for (i=0; i<k; i++)
+    {
+        c+=(uint64_t)((i < a->len)? a->d[i] : 0) + ((i < b->len)? b->d[i] : 0);
+        r[i]=(uint32_t)c;
+        c>>=32;
+    }
+    r[k]=(uint32_t)c;
+    return k+1;
+}
+
+int32 bnsubmag(uint32_t *r, struct Bn *a, struct Bn *b)
+/* r gets |a|-|b|, where |a| >= |b|; returns its length */
+{
+    int32 i;
+    int64_t c=0;
+
+    for (i=0; i<a->len; i++)
+    {
+        c+=(int64_t)a->d[i] - ((i < b->len)? b->d[i] : 0);
+        r[i]=(uint32_t)c;
+        c>>=32;     /* 0 or -1, the borrow */
+    }
+    return a->len;
+}
+
+void bnmulmag(uint32_t *r, struct Bn *a, struct Bn *b)
+/* r, of a->len+b->len limbs all 0, gets |a|*|b| */
+{
+    int32 i, j;
+    uint64_t c;
+
+    for (i=0; i<a->len; i++)
+    {
+        for (c=0, j=0; j<b->len; j++)
+        {
+            c+=(uint64_t)a->d[i]*b->d[j] + r[i+j];
+            r[i+j]=(uint32_t)c;
+            c>>=32;
+        }
+        r[i+b->len]=(uint32_t)c;
+    }
+}
+
+void bndivmag(uint32_t *q, uint32_t *r, uint32_t *u, int32 ulen, uint32_t *v, int32 k)
+/*-------------------------------------------------
+  q, of ulen-k+1 limbs, gets the quotient and r, of
+  k limbs, the remainder of the division of the ulen
+  limbs u by the k limbs v, where ulen >= k and
+  v[k-1] != 0.
+  This is Knuth's algorithm D: the divisor is shifted
+  so that its top bit is set, and every limb of the
+  quotient is estimated from the top limbs and then
+  corrected at most twice.
+-------------------------------------------------*/
+{
+    int32 i, j, s;
+    uint64_t p, qh, rh;
+    int64_t t, c;
+    uint32_t *un, *vn;
+
+    if (k EQ 1)
+    {
+        for (p=0, j=ulen-1; j>=0; j--)
+        {
+            p=p<<32 | u[j];
+            q[j]=(uint32_t)(p/v[0]);
+            p%=v[0];
+        }
+        r[0]=(uint32_t)p;
+        return;
+    }
+    s=__builtin_clz(v[k-1]);
+    vn=(uint32_t *)malloc(k*sizeof(uint32_t));
+    un=(uint32_t *)malloc((ulen+1)*sizeof(uint32_t));
+    for (i=k-1; i>0; i--) vn[i]=(v[i]<<s) | (uint32_t)((uint64_t)v[i-1]>>(32-s));
+    vn[0]=v[0]<<s;
+    un[ulen]=(uint32_t)((uint64_t)u[ulen-1]>>(32-s));
+    for (i=ulen-1; i>0; i--) un[i]=(u[i]<<s) | (uint32_t)((uint64_t)u[i-1]>>(32-s));
+    un[0]=u[0]<<s;
+    for (j=ulen-k; j>=0; j--)
+    {
+        p=(uint64_t)un[j+k]<<32 | un[j+k-1];
+        qh=p/vn[k-1];
+        rh=p-qh*vn[k-1];
+        while (qh >> 32 || qh*vn[k-2] > (rh<<32 | un[j+k-2]))
+        {
+            qh--;
+            rh+=vn[k-1];
+            if (rh >> 32) break;
+        }
+        /* un[j..j+k] -= qh*vn */
+        for (c=0, i=0; i<k; i++)
+        {
+            p=qh*vn[i];
+            t=(int64_t)un[i+j] - c - (int64_t)(p & 0xffffffff);
+            un[i+j]=(uint32_t)t;
+            c=(int64_t)(p>>32) - (t>>32);
+        }
+        t=(int64_t)un[j+k] - c;
+        un[j+k]=(uint32_t)t;
+        q[j]=(uint32_t)qh;
+        if (t<0)
+        {   /* qh was one too large: add vn back */
+            q[j]--;
+            for (c=0, i=0; i<k; i++)
+            {
+                t=(int64_t)un[i+j] + vn[i] + c;
+                un[i+j]=(uint32_t)t;
+                c=t>>32;
+            }
+            un[j+k]+=(uint32_t)c;
+        }
+    }
+    for (i=0; i<k; i++) r[i]=(un[i]>>s) | (uint32_t)((uint64_t)un[i+1]<<(32-s));
+    free(vn);
+    free(un);
+}
+
+int32 bigarith(struct Lispctx *cx, char op, int32 x, int32 y)
+/* returns x op y for the integers x and y; -1 if a quotient is not an integer */
+{
+    struct Bn a, b;
+    uint32_t *d, *r;
+    int32 k, len;
+    int16 neg;
+
+    bnof(cx, x, &a);
+    bnof(cx, y, &b);
+    /* nothing is allocated from here on until bnresult(), so a.d and b.d stay valid */
+    switch (op)
+    {
+        case '-':
+            b.neg=!b.neg;
+            /* fall through - x-y is x+(-y) */
+        case '+':
+            d=(uint32_t *)malloc(((a.len > b.len)? a.len : b.len)*sizeof(uint32_t)+sizeof(uint32_t));
+            if (a.neg EQ b.neg)         {len=bnaddmag(d, &a, &b); neg=a.neg;}
+            else if (bncmpmag(&a, &b) >= 0) {len=bnsubmag(d, &a, &b); neg=a.neg;}
+            else                        {len=bnsubmag(d, &b, &a); neg=b.neg;}
+            break;
+        case '*':
+            len=a.len+b.len;
+            d=(uint32_t *)calloc(len+1, sizeof(uint32_t));
+            bnmulmag(d, &a, &b);
+            neg=(a.neg != b.neg);
+            break;
+        case '/':
+            if (b.len EQ 0 || bncmpmag(&a, &b) < 0) return -1;  /* a/0, or a/b with 0 < |a| < |b| */
+            len=a.len-b.len+1;
+            d=(uint32_t *)malloc(len*sizeof(uint32_t));
+            r=(uint32_t *)malloc(b.len*sizeof(uint32_t));
+            bndivmag(d, r, a.d, a.len, b.d, b.len);
+            for (k=0; k<b.len && r[k] EQ 0; k++) ;
+            free(r);
+            if (k<b.len) {free(d); return -1;}
+            neg=(a.neg != b.neg);
+            break;
+        default:
+            error(cx, "dryrot: bad bigarith op");
+    }
+    return bnresult(cx, neg, d, len);
+}
+
+int32 arith(struct Lispctx *cx, char op, int32 x, int32 y, char *who)
+/* returns x op y, where op is one of + - * / */
+{
+    int64_t a, b;
+    int32 k;
+    double d, e, r;
+
+    if (type(x) EQ 9 && type(y) EQ 9)
+    {   /* the fast path: below IMAX, the double result of two integers is exact,
+           and so is a quotient of two integers that divide */
+        d=cx->Ntab[ptrv(x)].num;
+        e=cx->Ntab[ptrv(y)].num;
+        switch (op)
+        {
+            case '+': r=d+e; break;
+            case '-': r=d-e; break;
+            case '*': r=d*e; break;
+            default:  return numatom(cx, d/e);
+        }
+        if (fabs(r) < IMAX || !exact(cx, x, &a) || !exact(cx, y, &b)) return numatom(cx, r);
+        return bigarith(cx, op, x, y);
+    }
+    if ((type(x) EQ 6 || exact(cx, x, &a)) && (type(y) EQ 6 || exact(cx, y, &b))
+        && (k=bigarith(cx, op, x, y)) != -1)
+        return k;
+    d=numval(cx, x, who);
+    e=numval(cx, y, who);
+    switch (op)
+    {
+        case '+': return numatom(cx, d+e);
+        case '-': return numatom(cx, d-e);
+        case '*': return numatom(cx, d*e);
+        default:  return numatom(cx, d/e);
+    }
+}
+
+int32 sumprod(struct Lispctx *cx, int32 p, int16 prod)
+/*-------------------------------------------------
+  Returns the sum, or the product if prod is 1, of
+  the numbers in the list p, which is kept by the
+  caller. The partial result is a double, which is
+  exact like in arith(), until a result of two
+  integers reaches IMAX; from there on it is a
+  number or a big integer, kept on the skp list,
+  and arith() goes on with it. So only the result
+  goes into the number table in the common case.
+-------------------------------------------------*/
+{
+    int32 v;
+    int16 big=0;
+    double r=prod? 1.0 : 0.0, d, e;
+
+    for (; p != cx->nilptr; p=B(p))
+    {
+        v=A(p);
+        if (type(v) != 9 && type(v) != 6)
+            error(cx, prod? "PRODUCT application: trying to multiply a non-number value"
+                      : "SUM application: trying to sum a non-number value");
+        if (!big && type(v) EQ 9)
+        {
+            d=cx->Ntab[ptrv(v)].num;
+            e=prod? r*d : r+d;
+            if (fabs(e) < IMAX || r != floor(r) || fabs(r) > IMAX || d != floor(d) || fabs(d) > IMAX)
+            {
+                r=e;
+                continue;
+            }
+        }
+        if (!big) {skp=newloc(cx, numatom(cx, r), skp); big=1;}
+        A(skp)=arith(cx, prod? '*' : '+', A(skp), v, prod? "PRODUCT" : "SUM");
+    }
+    if (!big) return numatom(cx, r);
+    v=A(skp);
+    skp=B(skp);
+    return v;
+}
+
+int16 numcmp(struct Lispctx *cx, int32 x, int32 y, char *who)
+/* compares the numbers x and y: -1, 0 or 1 */
+{
+    struct Bn a, b;
+    double d, e;
+    int16 c;
+
+    if (type(x) EQ 9 && type(y) EQ 9)
+    {
+        d=cx->Ntab[ptrv(x)].num;
+        e=cx->Ntab[ptrv(y)].num;
+        return (d<e)? -1 : (d>e)? 1 : 0;
+    }
+    if (bnof(cx, x, &a) && bnof(cx, y, &b))
+    {
+        if (a.neg != b.neg) return a.neg? -1 : 1;  /* 0 is never negative */
+        c=bncmpmag(&a, &b);
+        return a.neg? -c : c;
+    }
+    d=numval(cx, x, who);
+    e=numval(cx, y, who);
+    return (d<e)? -1 : (d>e)? 1 : 0;
+}
+
+int32 bigneg(struct Lispctx *cx, int32 x)
+/* returns -x for the big integer x */
+{
+    int32 t, j=ptrv(x);
+
+    t=newbig(cx, cx->Btab[j].len);      /* x is kept by the caller */
+    cx->Btab[ptrv(t)].neg=!cx->Btab[j].neg;
+    memcpy(Bd(ptrv(t)), Bd(j), cx->Btab[j].len*sizeof(uint32_t));
+    return t;
+}
+
+int32 bigparse(struct Lispctx *cx, char *s, int16 neg)
+/* returns the integer of the decimal digits s */
+{
+    int32 len=0, i, k;
+    uint32_t *d=(uint32_t *)calloc(strlen(s)/9+2, sizeof(uint32_t));
+    uint64_t c, scale;
+
+    while (*s != EOS)
+    {   /* d = d*10^k + the next k <= 9 digits */
+        for (c=0, scale=1, k=0; k<9 && *s != EOS; k++, s++)
+        {
+            c=10*c+CHVAL(*s);
+            scale*=10;
+        }
+        for (i=0; i<len; i++)
+        {
+            c+=d[i]*scale;
+            d[i]=(uint32_t)c;
+            c>>=32;
+        }
+        if (c) d[len++]=(uint32_t)c;
+    }
+    return bnresult(cx, neg, d, len);
+}
+
+char *bigstr(struct Lispctx *cx, int32 j)
+/* returns the decimal digits of the big integer j in a string that the caller frees */
+{
+    int32 i, k, len=cx->Btab[j].len, nc=0;
+    uint32_t *d=(uint32_t *)malloc(len*sizeof(uint32_t));
+    uint32_t *ch=(uint32_t *)malloc((len*10/9+2)*sizeof(uint32_t));
+    char *s=(char *)malloc(len*10+2), *sp=s;
+    uint64_t p;
+
+    memcpy(d, Bd(j), len*sizeof(uint32_t));
+    while (len>0)
+    {   /* peel off the nine lowest decimal digits */
+        for (p=0, i=len-1; i>=0; i--)
+        {
+            p=p<<32 | d[i];
+            d[i]=(uint32_t)(p/1000000000);
+            p%=1000000000;
+        }
+        ch[nc++]=(uint32_t)p;
+        while (len>0 && d[len-1] EQ 0) len--;
+    }
+    if (nc EQ 0) ch[nc++]=0;    /* a zero magnitude, which bnresult never leaves in Btab */
+    if (cx->Btab[j].neg) *sp++='-';
+    sp+=sprintf(sp, "%u", ch[nc-1]);
+    for (k=nc-2; k>=0; k--) sp+=sprintf(sp, "%09u", ch[k]);
+    free(d);
+    free(ch);
+    return s;
+}
+
+void bsweep(struct Lispctx *cx)
+/* called by gc(): frees the unmarked big integers */
+{
+    int32 i;
+
+    for (i=0; i<NBIG; i++)
+    {
+        if (!cx->bmark[i]) cx->Btab[i].buf=-1;
+        cx->bmark[i]=0;
+    }
+}
+
+/* MEMOIZATION:
+   (MEMOIZE f n) gives the user-defined function f a cache of the values of
+   its last n calls, 1024 if n is left out, and returns f. A call of f whose
+   evaluated arguments are EQUAL to those of a call in the cache returns the
+   value of that call without evaluating the body; any other call evaluates
+   it and enters its value in the cache, in place of the least recently used
+   entry when the cache is full. The cache is a hash table on the EQUAL hash
+   of the argument list: its keys and values are kept in a vector, which the
+   collector marks from Mtab, and its slots, hashes and LRU links in a vector
+   of plain words. (MEMO-CLEAR f) empties the cache, (UNMEMOIZE f) drops it,
+   and so does a new definition of f. The cache is only correct for a
+   function whose value depends on nothing but its arguments. */
+
+#define MS(i)   ((int32 *)&cx->Vs[cx->Vtab[cx->Mtab[i].ix].base])   /* the slots: an entry+1, or 0 */
+#define MH(i)   (MS(i)+cx->Mtab[i].size)                    /* the hashes of the entries */
+#define MP(i)   (MH(i)+cx->Mtab[i].cap)                     /* the LRU links: the previous entry */
+#define MN(i)   (MP(i)+cx->Mtab[i].cap)                     /* and the next one */
+#define MK(i)   (&cx->Vs[cx->Vtab[cx->Mtab[i].kv].base])            /* the key of entry e at 2e, its value at 2e+1 */
+#define MEMOHASH 64     /* the number of nodes of an argument list that are hashed */
+
+uint32_t ehash(struct Lispctx *cx, int32 x, int32 *k)
+/* the EQUAL hash of x, over no more than *k nodes */
+{
+    uint32_t h=0;
+    int32 i;
+    char *b;
+
+    for (;;)
+    {
+        if (--*k < 0) return h;
+        switch (type(x))
+        {
+            case 0:
+                h=h*31+ehash(cx, A(x), k);
+                x=B(x);
+                continue;
+            case 5:
+                for (b=Sb(ptrv(x)), i=0; i<cx->Stab[ptrv(x)].len; i++) h=h*31+(unsigned char)b[i];
+                return h*31+5;
+            case 6:
+                for (i=0; i<cx->Btab[ptrv(x)].len; i++) h=h*31+Bd(ptrv(x))[i];
+                return h*31+cx->Btab[ptrv(x)].neg;
+            default:    /* atoms and numbers are EQUAL when they are EQ */
+                return h*31+hmix(x);
+        }
+    }
+}
+
+int16 equal(struct Lispctx *cx, int32 x, int32 y)
+/* tells whether x and y are EQUAL: the same atom or number, strings of the same bytes,
+   or lists of EQUAL elements */
+{
+    for (;;)
+    {
+        if (x EQ y) return 1;
+        if (type(x) != type(y)) return 0;
+        switch (type(x))
+        {
+            case 0:
+                if (!equal(cx, A(x), A(y))) return 0;
+                x=B(x);
+                y=B(y);
+                continue;
+            case 5:
+                return cx->Stab[ptrv(x)].len EQ cx->Stab[ptrv(y)].len
+                       && memcmp(Sb(ptrv(x)), Sb(ptrv(y)), cx->Stab[ptrv(x)].len) EQ 0;
+            case 6:
+                return numcmp(cx, x, y, "EQUAL") EQ 0;
+            default:
+                return 0;
+        }
+    }
+}
+
+int32 memoof(struct Lispctx *cx, int32 a)
+/* returns the Mtab entry of the function atom a, or -1 */
+{
+    int32 i;
+
+    for (i=0; i<NMEMO; i++)
+        if (cx->Mtab[i].fn EQ a)
+        {
+            if (cx->Mtab[i].def EQ cx->Atab[a].L) return i;
+            cx->Mtab[i].fn=-1;      /* a has been defined again */
+            cx->nmemo--;
+            return -1;
+        }
+    return -1;
+}
+
+int32 memoize(struct Lispctx *cx, int32 a, int32 cap)
+/* gives the function atom a an empty cache of cap entries */
+{
+    int32 i, size, kv, ix;
+
+    if ((i=memoof(cx, a)) >= 0)
+    {
+        cx->Mtab[i].fn=-1;  /* the old cache may be collected */
+        cx->nmemo--;
+    }
+    for (i=0; i<NMEMO && cx->Mtab[i].fn >= 0; i++) ;
+    if (i EQ NMEMO) error(cx, "MEMOIZE application: too many memoized functions");
+    for (size=2; size<2*cap; size*=2) ;
+    skp=newloc(cx, newvec(cx, VK_OBJ, 2*cap), skp);
+    ix=ptrv(newvec(cx, VK_WORDS, size+3*cap));
+    kv=ptrv(A(skp));
+    skp=B(skp);
+    cx->Mtab[i].fn=a;
+    cx->Mtab[i].def=cx->Atab[a].L;
+    cx->Mtab[i].kv=kv;
+    cx->Mtab[i].ix=ix;
+    cx->Mtab[i].cap=cap;
+    cx->Mtab[i].size=size;
+    cx->Mtab[i].count=0;
+    cx->Mtab[i].head=cx->Mtab[i].tail=-1;
+    cx->nmemo++;
+    return i;
+}
+
+void memoclear(struct Lispctx *cx, int32 i)
+/* empties the cache i */
+{
+    int32 j;
+
+    for (j=0; j<2*cx->Mtab[i].cap; j++) MK(i)[j]=cx->nilptr;
+    memset(MS(i), 0, cx->Mtab[i].size*sizeof(int32));
+    cx->Mtab[i].count=0;
+    cx->Mtab[i].head=cx->Mtab[i].tail=-1;
+}
+
+void memounlink(struct Lispctx *cx, int32 i, int32 e)
+/* takes the entry e out of the LRU list of the cache i */
+{
+    if (MP(i)[e] >= 0) MN(i)[MP(i)[e]]=MN(i)[e]; else cx->Mtab[i].head=MN(i)[e];
+    if (MN(i)[e] >= 0) MP(i)[MN(i)[e]]=MP(i)[e]; else cx->Mtab[i].tail=MP(i)[e];
+}
+
+void memofront(struct Lispctx *cx, int32 i, int32 e)
+/* makes the entry e the most recently used one of the cache i */
+{
+    MP(i)[e]=-1;
+    MN(i)[e]=cx->Mtab[i].head;
+    if (cx->Mtab[i].head >= 0) MP(i)[cx->Mtab[i].head]=e; else cx->Mtab[i].tail=e;
+    cx->Mtab[i].head=e;
+}
+
+int32 memoget(struct Lispctx *cx, int32 i, int32 args)
+/* returns the cached value of the call with the arguments args, or -1 */
+{
+    int32 j, e, k=MEMOHASH, mask=cx->Mtab[i].size-1;
+    uint32_t h=ehash(cx, args, &k);
+
+    for (j=h&mask; (e=MS(i)[j]) != 0; j=(j+1)&mask)
+        if ((uint32_t)MH(i)[--e] EQ h && equal(cx, MK(i)[2*e], args))
+        {
+            if (cx->Mtab[i].head != e)
+            {
+                memounlink(cx, i, e);
+                memofront(cx, i, e);
+            }
+            return MK(i)[2*e+1];
+        }
+    return -1;
+}
+
+void memoput(struct Lispctx *cx, int32 i, int32 args, int32 v)
+/* enters the value v of the call with the arguments args in the cache i */
+{
+    int32 j, e, t, home, k=MEMOHASH, mask=cx->Mtab[i].size-1;
+    int32 *s;
+    uint32_t h=ehash(cx, args, &k);
+
+    s=MS(i);    /* nothing here allocates */
+    if (cx->Mtab[i].count < cx->Mtab[i].cap) e=cx->Mtab[i].count++;
+    else
+    {   /* evict the least recently used entry, and close the gap in its probe sequence */
+        e=cx->Mtab[i].tail;
+        memounlink(cx, i, e);
+        for (j=MH(i)[e]&mask; s[j] != e+1; j=(j+1)&mask) ;
+        s[j]=0;
+        for (t=(j+1)&mask; s[t] != 0; t=(t+1)&mask)
+        {
+            home=MH(i)[s[t]-1]&mask;
+            if ((j<t)? (home>j && home<=t) : (home>j || home<=t)) continue;
+            s[j]=s[t];
+            s[t]=0;
+            j=t;
+        }
+    }
+    MK(i)[2*e]=args;
+    MK(i)[2*e+1]=v;
+    MH(i)[e]=(int32)h;
+    for (j=h&mask; s[j] != 0; j=(j+1)&mask) ;
+    s[j]=e+1;
+    memofront(cx, i, e);
+}
+
+/* HASH-CONSING:
+   (HCONS x y) returns the node (x . y) like CONS, but only one such node is
+   made: another HCONS of the same x and y returns the same node, so that the
+   equal structures built with HCONS share their storage and are EQ. After
+   (HCONS-READ T), sread builds every list it reads this way, until
+   (HCONS-READ NIL); both return the previous setting. The nodes are found
+   through a hash table on their CAR and CDR that does not keep them: gc()
+   drops the nodes that nothing else reaches (hcprune). A hash-consed node
+   must not be changed with RPLACA or RPLACD; SORT sorts a list with such
+   nodes as a copy. */
+
+#define HCS(j)  ((int32 *)&cx->Vs[cx->Vtab[cx->hctab].base]+(j))   /* a slot of the table */
+#define hcpair(x,y) hmix((int32)((uint32_t)(x)*31 + hmix(y)))
+#define hckey(c) hcpair(A(c) & 0xf7ffffff, B(c))    /* without the gc mark */
+
+void hcinsert(struct Lispctx *cx, int32 c)
+/* puts the node c into a free slot of the table */
+{
+    int32 j, mask=cx->Vtab[cx->hctab].len-1;
+
+    for (j=hckey(c)&mask; *HCS(j) != 0; j=(j+1)&mask) ;
+    *HCS(j)=c;
+    cx->hccount++;
+}
+
+int16 hconsed(struct Lispctx *cx, int32 c)
+/* tells whether the node c is in the table */
+{
+    int32 j, k, mask;
+
+    if (cx->hctab < 0) return 0;
+    mask=cx->Vtab[cx->hctab].len-1;
+    for (j=hckey(c)&mask; (k=*HCS(j)) != 0; j=(j+1)&mask)
+        if (k EQ c) return 1;
+    return 0;
+}
+
+void hcgrow(struct Lispctx *cx)
+/* doubles the table, or makes the first one */
+{
+    int32 j, k, t, old=cx->hctab, len;
+
+    len=(cx->hctab<0)? 256 : 2*cx->Vtab[cx->hctab].len;
+    t=newvec(cx, VK_WORDS, len);    /* a collection here prunes the old table */
+    cx->hctab=ptrv(t);
+    cx->hccount=0;
+    if (old<0) return;
+    for (j=0; j<cx->Vtab[old].len; j++)
+        if ((k=((int32 *)&cx->Vs[cx->Vtab[old].base])[j]) != 0) hcinsert(cx, k);
+}
+
+int32 hcons(struct Lispctx *cx, int32 x, int32 y)
+/* returns the one node (x . y) made by HCONS */
+{
+    int32 j, c, mask;
+
+    if (cx->hctab >= 0)
+    {
+        mask=cx->Vtab[cx->hctab].len-1;
+        for (j=hcpair(x, y)&mask; (c=*HCS(j)) != 0; j=(j+1)&mask)
+            if (A(c) EQ x && B(c) EQ y) return c;
+    }
+    /* x and y are kept by the caller, and newloc() keeps them over a collection */
+    c=newloc(cx, x, y);
+    if (cx->hctab < 0 || 2*(cx->hccount+1) > cx->Vtab[cx->hctab].len)
+    {
+        skp=newloc(cx, c, skp);
+        hcgrow(cx);
+        skp=B(skp);
+    }
+    hcinsert(cx, c);
+    return c;
+}
+
+int32 hshare(struct Lispctx *cx, int32 x)
+/* returns the hash-consed copy of the list x, which is kept by the caller */
+{
+    int32 a, b;
+
+    if (!dottedpair(type(x))) return x;
+    if (hconsed(cx, x)) return x;   /* a part that sread has already shared ends the copy */
+    skp=newloc(cx, hshare(cx, A(x)), skp);
+    b=hshare(cx, B(x));
+    a=A(skp);
+    skp=B(skp);
+    return hcons(cx, a, b);
+}
+
+void hcprune(struct Lispctx *cx)
+/* called by gc() before the nodes are unmarked: drops the unmarked nodes from the table */
+{
+    int32 j, k, len, *keep;
+
+    if (cx->hctab < 0) return;
+    len=cx->Vtab[cx->hctab].len;
+    keep=(int32 *)malloc(len*sizeof(int32));
+    for (k=0, j=0; j<len; j++)
+        if (*HCS(j) != 0 && marked(*HCS(j))) keep[k++]=*HCS(j);
+    memset(HCS(0), 0, len*sizeof(int32));
+    cx->hccount=0;
+    for (j=0; j<k; j++) hcinsert(cx, keep[j]);
+    free(keep);
+}
+
+/* THE OPTIMIZER:
+   When SETQ (or SET) gives an atom a LAMBDA or SPECIAL value, optdef makes
+   an optimized copy of its body, which seval evaluates in place of the body
+   itself; BODY still returns the definition as it was given. In the copy,
+     - a call of a builtin has the builtin in place of its atom, so that seval
+       finds the function without looking the atom up,
+     - a call of PLUS, DIFFERENCE, TIMES, QUOTIENT, POWER, MINUS, FLOOR,
+       LESSP, GREATERP, SUM, PRODUCT or NUMBERP with numbers for arguments
+       is replaced by its value,
+     - a COND clause whose test is NIL or quoted NIL is dropped, the clauses
+       after one whose test is a constant are dropped, and a COND in the last
+       clause of a COND is merged into it,
+     - an AND or OR in an AND or an OR of the same kind is merged into it, and
+       the constant arguments that cannot change the result are dropped.
+   The arguments of the calls of user-defined functions and special forms are
+   copied as they are, since what they mean is up to the callee, and so are
+   the calls whose operator is a parameter of the function or an atom that is
+   bound at the moment; only the quoted data is shared with the definition.
+   The copy is made of list area nodes (see codecopy), and so are the
+   parameter lists that LAMBDA and SPECIAL take. The copy relies only on the
+   top-level values of the builtins, T and NIL, so an assignment to one of
+   them by SETQ or SET advances optepoch, and a body made in an older epoch is made again at its
+   next call. Binding a parameter does not change them for good: while a
+   parameter hides one of them (see hides), the definitions are evaluated as
+   they are, and their copies are used again once it is unbound. Should an
+   atom of a builtin in a copy have lost its value while the copy is
+   evaluated, seval treats the call as that of an invalid function. A
+   definition whose parameters are not atoms, or T or NIL, is not optimized. */
+
+#define optop(x)    ((type(x) EQ 8 || builtin(type(x))) && builtin(type(AL(ptrv(x)))) \
+                     && Abl(ptrv(x)) EQ cx->nilptr && !optparam(cx, x))
+#define isop(x,k)   (dottedpair(type(x)) && optop(A(x)) && ptrv(AL(ptrv(A(x)))) EQ (k))
+#define isquote(x)  (dottedpair(type(x)) && (type(A(x)) EQ 8 || builtin(type(A(x)))) && ptrv(A(x)) EQ ptrv(cx->quoteptr))
+#define isnum(x)    (type(x) EQ 9 || type(x) EQ 6)
+#define isfalse(x)  ((x) EQ cx->nilptr || (isop(x, 9) && dottedpair(type(B(x))) && A(B(x)) EQ cx->nilptr))
+#define istrue(x)   (isnum(x) || type(x) EQ 5 || ((x) EQ cx->tptr && AL(ptrv(cx->tptr)) EQ cx->tptr && Abl(ptrv(cx->tptr)) EQ cx->nilptr) \
+                     || (isop(x, 9) && dottedpair(type(B(x))) && A(B(x)) != cx->nilptr))
+
+int16 optdef(struct Lispctx *cx, int32 a)
+/* makes the optimized body of the function that is the value of the atom a; 0 if it has none */
+{
+    int32 f=ptrv(cx->Atab[a].L), t;
+
+    cx->Atab[a].opt=cx->nilptr;
+    if (type(A(f)) != 8)
+        for (t=A(f); t != cx->nilptr; t=B(t))
+            if (!dottedpair(type(t)) || type(A(t)) != 8) return 0;
+    cx->optpar=A(f);
+    if (optparam(cx, cx->tptr) || optparam(cx, cx->nilptr)) return 0;
+    /* the definition is kept by a, and newloc() keeps the new body over a collection */
+    t=optexpr(cx, B(f));
+    cx->Atab[a].opt=newloc(cx, cx->Atab[a].L, t);
+    cx->Atab[a].optep=cx->optepoch;
+    return 1;
+}
+
+int16 optparam(struct Lispctx *cx, int32 x)
+/* tells whether the atom of the operator x is a parameter of the function optdef is optimizing */
+{
+    int32 t;
+
+    if (type(cx->optpar) EQ 8) return cx->optpar != cx->nilptr && ptrv(cx->optpar) EQ ptrv(x);
+    for (t=cx->optpar; t != cx->nilptr; t=B(t))
+        if (ptrv(A(t)) EQ ptrv(x)) return 1;
+    return 0;
+}
+
+int32 optlist(struct Lispctx *cx, int32 x, int32 k)
+/*-------------------------------------------------
+  Returns the optimized copy of the argument list x
+  of the builtin k. The arguments of AND (24) and OR
+  (25) are merged and dropped as described above.
+-------------------------------------------------*/
+{
+    int32 t, u, tail=cx->nilptr;
+
+    skp=newloc(cx, cx->nilptr, skp);    /* the copy under construction */
+    for (; dottedpair(type(x)); x=B(x))
+    {
+        t=optexpr(cx, A(x));
+        if (k EQ 24 || k EQ 25)
+        {
+            if ((k EQ 24)? istrue(t) : isfalse(t)) continue;
+            if (isop(t, k))
+            {   /* splice in the arguments, which are optimized already */
+                for (u=B(t); u != cx->nilptr; u=B(u))
+                {
+                    t=newloc(cx, A(u), cx->nilptr);
+                    if (tail EQ cx->nilptr) A(skp)=t; else setcdr(cx, tail, t);
+                    tail=t;
+                }
+                continue;
+            }
+        }
+        t=newloc(cx, t, cx->nilptr);
+        if (tail EQ cx->nilptr) A(skp)=t; else setcdr(cx, tail, t);
+        tail=t;
+        if ((k EQ 24)? isfalse(A(t)) : (k EQ 25)? istrue(A(t)) : 0) break;   /* the rest is never evaluated */
+    }
+    t=A(skp);
+    skp=B(skp);
+    return t;
+}
+
+int32 optcond(struct Lispctx *cx, int32 x)
+/* returns the optimized copy of the clauses x of a COND */
+{
+    int32 c, t, tail=cx->nilptr;
+
+    skp=newloc(cx, cx->nilptr, skp);
+    for (; dottedpair(type(x)); x=B(x))
+    {
+        c=A(x);
+        if (dottedpair(type(c)) && dottedpair(type(B(c))))
+        {   /* a clause (test value): the copy is (test' value') */
+            t=newloc(cx, optexpr(cx, A(B(c))), cx->nilptr);
+            skp=newloc(cx, t, skp);     /* keep value' while test' is made */
+            c=newloc(cx, optexpr(cx, A(c)), t);
+            skp=B(skp);
+        }
+        if (dottedpair(type(c)) && isfalse(A(c))) continue;
+        if (dottedpair(type(c)) && istrue(A(c)) && dottedpair(type(B(c))) && isop(A(B(c)), 12))
+            t=B(A(B(c)));       /* (... (T (COND clauses))) is (... clauses) */
+        else
+            t=newloc(cx, c, cx->nilptr);
+        if (tail EQ cx->nilptr) A(skp)=t; else setcdr(cx, tail, t);
+        if (t EQ cx->nilptr) break;
+        for (tail=t; B(tail) != cx->nilptr; tail=B(tail)) ;
+        if (dottedpair(type(c)) && istrue(A(c))) break;    /* the rest is never reached */
+    }
+    t=A(skp);
+    skp=B(skp);
+    return t;
+}
+
+int32 codecopy(struct Lispctx *cx, int32 x)
+/* returns a copy of the expression x, which is kept by the caller, in list
+   area nodes, so that seval does not walk compact ones; the quoted data in
+   it is shared with x */
+{
+    int32 t, *endv;
+
+    if (!dottedpair(type(x)) || isquote(x)) return x;
+    skp=newloc(cx, cx->nilptr, skp);
+    endv=&A(skp);
+    for (; dottedpair(type(x)); x=B(x))
+    {
+        *endv=t=newloc(cx, cx->nilptr, cx->nilptr);
+        A(t)=codecopy(cx, A(x));
+        endv=&Bl(t);
+    }
+    *endv=x;        /* NIL, or the atom that ends a dotted list */
+    t=A(skp);
+    skp=B(skp);
+    return t;
+}
+
+int32 optexpr(struct Lispctx *cx, int32 x)
+/* returns the optimized copy of the expression x, which is kept by the caller */
+{
+    int32 op, k, t, n2;
+
+    if (!dottedpair(type(x))) return x;
+    op=A(x);
+    if (!optop(op)) return codecopy(cx, x);
+    k=ptrv(cx->Atab[ptrv(op)].L);
+    op=tp(type(cx->Atab[ptrv(op)].L)<<28, ptrv(op));    /* the builtin itself */
+    switch (k)
+    {
+        case 6:     /* SETQ */
+            if (dottedpair(type(B(x))) && dottedpair(type(B(B(x)))) && B(B(B(x))) EQ cx->nilptr)
+            {
+                t=newloc(cx, optexpr(cx, A(B(B(x)))), cx->nilptr);
+                return newloc(cx, op, newloc(cx, A(B(x)), t));
+            }
+            return newloc(cx, op, codecopy(cx, B(x)));
+        case 12:    /* COND */
+            return newloc(cx, op, optcond(cx, B(x)));
+        case 24: case 25:   /* AND, OR */
+            return newloc(cx, op, optlist(cx, B(x), k));
+    }
+    if (type(op) != 10) return newloc(cx, op, isquote(x)? B(x) : codecopy(cx, B(x)));  /* the other special forms */
+    t=newloc(cx, op, optlist(cx, B(x), k));
+    /* a call of an arithmetic builtin with numbers for arguments is replaced by its value */
+    for (n2=0, x=B(t); x != cx->nilptr && isnum(A(x)); x=B(x)) n2++;
+    if (x EQ cx->nilptr
+        && (((k EQ 8 || k EQ 18 || k EQ 19) && n2 EQ 1) || (k>=13 && k<=21 && k != 18 && k != 19 && n2 EQ 2)
+            || k EQ 26 || k EQ 27))
+    {
+        skp=newloc(cx, t, skp);
+        t=seval(cx, t);
+        skp=B(skp);
+    }
+    return t;
+}
+
+/* STREAMS:
+   (DELAY x) returns a promise of the value of x without evaluating it, and
+   (FORCE d) evaluates the x of the promise d the first time it is called and
+   returns that value then and ever after; FORCE returns anything else than a
+   promise as it is. Since the variables are bound dynamically, a promise
+   keeps the values of the atoms of x that are bound by a function call when
+   it is made, and x is evaluated under those bindings; the other atoms get
+   their values at the time it is forced. Once forced, the promise lets go of
+   x and the bindings.
+   A stream is NIL or a node whose CAR is its first element and whose CDR is
+   a promise of the rest of the stream: (SCONS x y) is (CONS x (DELAY y)),
+   (SCAR s) is (CAR s) and (SCDR s) is (FORCE (CDR s)). (STAKE s k) returns
+   the list of the first k elements of s, or all of them if s is shorter, and
+   (SDROP s k) the stream after them. Both let go of the part of s they have
+   passed, so a stream that nothing else keeps is collected as they go on:
+     (SETQ INTS (LAMBDA (N) (SCONS N (INTS (PLUS N 1)))))
+     (SDROP (INTS 0) 1000000)
+   runs in a constant amount of storage. */
+
+int32 newobj(struct Lispctx *cx, char kind, int32 a, int32 b)
+/* returns a typed pointer to a new object of the given kind */
+{
+    int32 i, tries;
+
+    for (tries=0; ; tries++)
+    {
+        for (i=0; i<NOBJ && cx->Otab[i].kind != OK_FREE; i++) ;
+        if (i<NOBJ) break;
+        if (tries>0) error(cx, "object table is full");
+        skp=newloc(cx, a, newloc(cx, b, skp));
+        gc(cx, GC_CALL);
+        skp=B(B(skp));
+    }
+    cx->Otab[i].kind=kind;
+    cx->Otab[i].forced=0;
+    cx->Otab[i].a=a;
+    cx->Otab[i].b=b;
+    cx->Otab[i].f=NULL;
+    cx->Otab[i].buf=NULL;
+    return tp(0x70000000, i);
+}
+
+void delayenv(struct Lispctx *cx, int32 x, int32 s)
+/* adds the bindings (atom . value) of the atoms of x that are bound by a
+   function call, and are not in it yet, to the list A(s) */
+{
+    int32 t;
+
+    for (;;)
+    {
+        if (type(x) EQ 8)
+        {
+            if (Abl(ptrv(x)) EQ cx->nilptr) return;
+            for (t=A(s); t != cx->nilptr; t=B(t))
+                if (A(A(t)) EQ x) return;
+            t=newloc(cx, x, AL(ptrv(x)));
+            A(s)=newloc(cx, t, A(s));
+            return;
+        }
+        if (!dottedpair(type(x))) return;
+        delayenv(cx, A(x), s);
+        x=B(x);
+    }
+}
+
+int32 delay(struct Lispctx *cx, int32 x)
+/* returns a promise of x, which is kept by the caller */
+{
+    int32 v;
+
+    skp=newloc(cx, cx->nilptr, skp);
+    delayenv(cx, x, skp);
+    v=newobj(cx, OK_PROMISE, x, A(skp));
+    skp=B(skp);
+    return v;
+}
+
+int32 force(struct Lispctx *cx, int32 x)
+/* returns the value of the promise x, which is kept by the caller, or x if it is not a promise */
+{
+    int32 i=ptrv(x), e, v;
+
+    if (type(x) != 7 || cx->Otab[i].kind != OK_PROMISE) return x;
+    if (cx->Otab[i].forced) return cx->Otab[i].a;
+    for (e=cx->Otab[i].b; e != cx->nilptr; e=B(e)) bindatom(cx, ptrv(A(A(e))), B(A(e)));
+    v=seval(cx, cx->Otab[i].a);
+    for (e=cx->Otab[i].b; e != cx->nilptr; e=B(e)) unbindatom(cx, ptrv(A(A(e))));
+    /* x may have been forced while it was being evaluated; the first value stays */
+    if (!cx->Otab[i].forced)
+    {
+        cx->Otab[i].forced=1;
+        cx->Otab[i].a=v;
+        cx->Otab[i].b=cx->nilptr;
+    }
+    return cx->Otab[i].a;
+}
+
+int32 stream(struct Lispctx *cx, int32 p, int16 take)
+/* does (STAKE s k), or (SDROP s k) if take is 0, for the evaluated argument
+   list p; its first node holds the part of s that has not been passed yet */
+{
+    int32 s, t, k, i;
+    char *who=take? "STAKE application: " : "SDROP application: ";
+
+    if (type(A(B(p))) != 9 || cx->Ntab[ptrv(A(B(p)))].num < 0 || cx->Ntab[ptrv(A(B(p)))].num > 2e9)
+    {
+        sprintf(cx->sout, "%sa count of elements expected", who);
+        error(cx, cx->sout);
+    }
+    k=(int32)cx->Ntab[ptrv(A(B(p)))].num;
+    skp=newloc(cx, cx->nilptr, skp);    /* the list taken */
+    for (s=A(p), t=cx->nilptr, i=0; i<k && s != cx->nilptr; i++)
+    {
+        if (!dottedpair(type(s)))
+        {
+            sprintf(cx->sout, "%sa stream expected", who);
+            error(cx, cx->sout);
+        }
+        if (take)
+        {
+            if (t EQ cx->nilptr) t=A(skp)=newloc(cx, A(s), cx->nilptr);
+            else t=Bl(t)=newloc(cx, A(s), cx->nilptr);
+            if (i EQ k-1) break;    /* the rest is not needed */
+        }
+        s=force(cx, B(s));
+        A(p)=s;
+    }
+    t=take? A(skp) : s;
+    skp=B(skp);
+    return t;
+}
+
+void osweep(struct Lispctx *cx)
+/* called by gc(): frees the unmarked objects, closing the inputs among them */
+{
+    int32 i;
+
+    for (i=0; i<NOBJ; i++)
+    {
+        if (!cx->omark[i])
+        {
+            if (cx->Otab[i].kind EQ OK_INPUT) closeinput(cx, i);
+            cx->Otab[i].kind=OK_FREE;
+        }
+        cx->omark[i]=0;
+    }
+}
+
+/* RECORD INPUT:
+   (OPEN-INPUT name) opens the file whose name is the string name and returns
+   an input of it. (READ-RECORD h) reads the next S-expression from the input
+   h and returns it without evaluating it, or NIL, or eof if it is given as
+   in (READ-RECORD h eof), when the file has no more of them. (CLOSE-INPUT h)
+   closes the input; so does the collection of an input that nothing keeps.
+   READ-RECORD reads with sread and e(), like READ, from the line of the input
+   that it moves into g in place of the line of the current input stream, and
+   moves back when it has read a record. So a file of any number of records
+   is read one record at a time, and the records are left for the collector
+   once the program has done with them. An input is not an input stream of
+   its own for e(): an @name in it is just an atom, and an end of the file
+   inside a record is an error. */
+
+int32 openinput(struct Lispctx *cx, int32 x)
+/* returns a new input of the file named by the string x */
+{
+    int32 j=strof(cx, x, "OPEN-INPUT"), h=newobj(cx, OK_INPUT, 0, 0);
+    char *name=(char *)malloc(cx->Stab[j].len+1);   /* x is kept by the caller */
+
+    memcpy(name, Sb(j), cx->Stab[j].len);
+    name[cx->Stab[j].len]=EOS;
+    cx->Otab[ptrv(h)].f=fopen(name, "r");
+    free(name);
+    if (cx->Otab[ptrv(h)].f EQ NULL) error(cx, "OPEN-INPUT application: cannot open the file");
+    cx->Otab[ptrv(h)].buf=(char *)calloc(202, sizeof(char));
+    return h;
+}
+
+int32 readrecord(struct Lispctx *cx, int32 h, int32 eof)
+/* reads the next record from the input h, which is kept by the caller, or returns eof */
+{
+    struct Object *o;
+    int32 v;
+    char c, pr=cx->prompt;
+
+    if (type(h) != 7 || cx->Otab[ptrv(h)].kind != OK_INPUT) error(cx, "READ-RECORD application: an input expected");
+    o=&cx->Otab[ptrv(h)];
+    if (o->f EQ NULL) error(cx, "READ-RECORD application: the input is closed");
+    /* save the current input stream like an @name does, and read from the line of h */
+    cx->rdsave=(struct Insave *)calloc(1, sizeof(struct Insave));
+    strcpy(cx->rdsave->ig, cx->g);
+    cx->rdsave->ipg=cx->pg;
+    cx->rdsave->ipge=cx->pge;
+    cx->rdsave->ifilep=cx->filep;
+    cx->rdin=ptrv(h);
+    strcpy(cx->g, o->buf);
+    cx->pg=cx->g+o->a;
+    cx->pge=cx->g+o->b;
+    cx->filep=o->f;
+
+    while ((c=lookgchar(cx)) EQ BLANK) getgchar(cx);
+    v=(c EQ EOS)? eof : sread(cx);
+    rdend(cx);
+    cx->prompt=pr;
+    return v;
+}
+
+void rdend(struct Lispctx *cx)
+/* gives the line being read back to the input rdin and restores the input stream */
+{
+    struct Object *o=&cx->Otab[cx->rdin];
+
+    strcpy(o->buf, cx->g);
+    o->a=cx->pg-cx->g;
+    o->b=cx->pge-cx->g;
+    strcpy(cx->g, cx->rdsave->ig);
+    cx->pg=cx->rdsave->ipg;
+    cx->pge=cx->rdsave->ipge;
+    cx->filep=cx->rdsave->ifilep;
+    free(cx->rdsave);
+    cx->rdsave=NULL;
+    cx->pb=0;
+}
+
+void closeinput(struct Lispctx *cx, int32 i)
+/* closes the input Otab[i], if it is open */
+{
+    if (cx->Otab[i].f EQ NULL) return;
+    fclose(cx->Otab[i].f);
+    free(cx->Otab[i].buf);
+    cx->Otab[i].f=NULL;
+    cx->Otab[i].buf=NULL;
+}
+
+/* ITERATION:
+   (WHILE test x1 x2 ...) evaluates x1, x2, ... as long as test is not NIL,
+   and returns NIL. (DOTIMES (a k r) x1 x2 ...) evaluates x1, x2, ... with
+   the atom a bound to 0, 1, ..., k-1 in turn, and (DOLIST (a s r) x1 x2 ...)
+   with a bound to the elements of the list s in turn; then both return the
+   value of r, which may be left out for NIL, with a bound to k or to NIL.
+   The atom is bound once, and each turn only changes its value, so a loop
+   takes no list nodes of its own and no seval frame per turn, unlike a
+   recursive function. The numbers DOTIMES counts with are not free, though:
+   every one of them goes into the number table like any other number, and
+   stays there until a collection finds it unreachable, so a long loop runs
+   collections of its own (an empty (DOTIMES (I 5000) NIL) runs 6 with a
+   table of 1000). The counter cannot be one number changed in place, since
+   the body may keep its value, and equal numbers have to be EQ. */
+
+void bindatom(struct Lispctx *cx, int32 t, int32 v)
+/* binds the atom t to v, which is kept by the caller, like seval binds a parameter */
+{
+    if (hides(t)) cx->shadowed++;
+    Abl(t)=newloc(cx, AL(t), Abl(t));
+    AL(t)=v;
+}
+
+void unbindatom(struct Lispctx *cx, int32 t)
+/* undoes bindatom */
+{
+    AL(t)=A(Abl(t));
+    Abl(t)=B(Abl(t));
+    if (hides(t)) cx->shadowed--;
+}
+
+int32 doloop(struct Lispctx *cx, int32 p, int16 list)
+/* does (DOTIMES ...), or (DOLIST ...) if list is 1, for the unevaluated argument list p */
+{
+    int32 h=A(p), a, x, t, b, v;
+    double i, k=0;
+
+    if (!dottedpair(type(h)) || type(A(h)) != 8 || A(h) EQ cx->nilptr || A(h) EQ cx->tptr
+        || !dottedpair(type(B(h))) || (B(B(h)) != cx->nilptr && B(B(B(h))) != cx->nilptr))
+    {
+        sprintf(cx->sout, "%s application: (atom %s result) expected", list? "DOLIST" : "DOTIMES", list? "list" : "count");
+        error(cx, cx->sout);
+    }
+    a=ptrv(A(h));
+    x=touch(cx, seval(cx, A(B(h))));
+    if (!list)
+    {
+        if (type(x) != 9) error(cx, "DOTIMES application: the count must be a number");
+        k=cx->Ntab[ptrv(x)].num;
+    }
+    skp=newloc(cx, x, skp);
+    bindatom(cx, a, cx->nilptr);
+    if (list)
+        for (t=x; dottedpair(type(t)); t=B(t))
+        {
+            AL(a)=A(t);
+            for (b=B(p); b != cx->nilptr; b=B(b)) seval(cx, A(b));
+        }
+    else
+        for (i=0; i<k; i++)
+        {
+            AL(a)=numatom(cx, i);
+            for (b=B(p); b != cx->nilptr; b=B(b)) seval(cx, A(b));
+        }
+    AL(a)=list? cx->nilptr : x;
+    v=(B(B(h)) != cx->nilptr)? seval(cx, A(B(B(h)))) : cx->nilptr;
+    unbindatom(cx, a);
+    skp=B(skp);
+    return v;
+}
+
+/* SORTING:
+   (SORT s pr) sorts the list s with the predicate pr, which is true when its
+   first argument goes before its second, and returns the sorted list. The
+   sort is stable: the elements that neither goes before the other stay in
+   the order they were in. It is a bottom-up merge sort, which merges the runs
+   of 1, 2, 4, ... elements by linking the nodes of a copy of s anew. The
+   copy is made of list area nodes, whose CDRs can be changed in place, and
+   s is left as it was, whatever its nodes: those of a compact list have no
+   CDRs of their own to relink (see newlist), and hash-consed ones may be
+   shared by other lists (see hcons). So SORT takes a node for every element
+   of s, like a copy would. When pr is LESSP or GREATERP and the elements
+   are all numbers, they are compared here; any other pr is applied to them
+   with one call form, made before the sort, whose arguments are changed for
+   each comparison. */
+
+#define SORT_CALL       0   /* apply the predicate */
+#define SORT_LESSP      1   /* compare numbers that are all in Ntab */
+#define SORT_GREATERP   2
+#define SORT_NUMLESS    3   /* compare numbers that may be big integers */
+#define SORT_NUMGREATER 4
+
+int32 lcopy(struct Lispctx *cx, int32 x)
+/* returns a copy of the proper list x, which is kept by the caller, in list area nodes */
+{
+    int32 v, *endv;
+
+    skp=newloc(cx, cx->nilptr, skp);
+    endv=&A(skp);
+    for (; x != cx->nilptr; x=B(x))
+    {
+        *endv=newloc(cx, A(x), cx->nilptr);
+        endv=&Bl(*endv);
+    }
+    v=A(skp);
+    skp=B(skp);
+    return v;
+}
+
+int16 sortbefore(struct Lispctx *cx, int16 how, int32 x, int32 y, int32 c)
+/* returns 1 if x goes before y; c is the call form (pr (QUOTE x) (QUOTE y)) */
+{
+    switch (how)
+    {
+        case SORT_LESSP:        return cx->Ntab[ptrv(x)].num < cx->Ntab[ptrv(y)].num;
+        case SORT_GREATERP:     return cx->Ntab[ptrv(x)].num > cx->Ntab[ptrv(y)].num;
+        case SORT_NUMLESS:      return numcmp(cx, x, y, "SORT") < 0;
+        case SORT_NUMGREATER:   return numcmp(cx, x, y, "SORT") > 0;
+    }
+    A(B(A(B(c))))=x;
+    A(B(A(B(B(c)))))=y;
+    return touch(cx, seval(cx, c)) != cx->nilptr;
+}
+
+int32 lsort(struct Lispctx *cx, int32 x, int32 pr)
+/* returns a copy of the list x, which is kept by the caller, sorted with pr */
+{
+    int32 r, c, t, q, e, tail, k, pk, qk, merges;
+    int16 how=SORT_CALL, big=0;
+
+    if (x EQ cx->nilptr || B(x) EQ cx->nilptr) return x;
+    skp=newloc(cx, lcopy(cx, x), skp);  /* the copy that is sorted */
+    x=A(skp);
+    if (type(pr) EQ 10 && (ptrv(AL(ptrv(pr))) EQ 20 || ptrv(AL(ptrv(pr))) EQ 21))
+    {   /* LESSP or GREATERP */
+        for (t=x; t != cx->nilptr && (type(A(t)) EQ 9 || type(A(t)) EQ 6); t=B(t))
+            if (type(A(t)) EQ 6) big=1;
+        if (t EQ cx->nilptr)
+            how=(ptrv(AL(ptrv(pr))) EQ 20)? (big? SORT_NUMLESS : SORT_LESSP) : (big? SORT_NUMGREATER : SORT_GREATERP);
+    }
+    r=c=cx->nilptr;
+    if (how EQ SORT_CALL)
+    {   /* r keeps the nodes while pr is applied: A(r) is the merged list, A(B(r))
+           and A(B(B(r))) the rest of the two runs being merged; the list goes on
+           after the second one. c, the call form, is kept on skp as well. */
+        skp=newloc(cx, newlist(cx, 3), skp);
+        r=A(skp);
+        A(r)=newloc(cx, newloc(cx, cx->quoteptr, newloc(cx, cx->nilptr, cx->nilptr)), cx->nilptr);
+        A(r)=newloc(cx, newloc(cx, cx->quoteptr, newloc(cx, cx->nilptr, cx->nilptr)), A(r));
+        c=newloc(cx, pr, A(r));
+        skp=newloc(cx, c, skp);
+    }
+    for (k=1; ; k*=2)
+    {
+        t=x;
+        x=tail=cx->nilptr;
+        for (merges=0; t != cx->nilptr; merges++)
+        {   /* merge the run of k nodes from t with the run of k nodes after it */
+            for (q=t, pk=0; pk<k && q != cx->nilptr; pk++) q=B(q);
+            qk=k;
+            while (pk>0 || (qk>0 && q != cx->nilptr))
+            {
+                if (pk EQ 0) {e=q; q=B(q); qk--;}
+                else if (qk EQ 0 || q EQ cx->nilptr) {e=t; t=B(t); pk--;}
+                else
+                {
+                    if (r != cx->nilptr) {A(r)=x; A(B(r))=t; A(B(B(r)))=q;}
+                    if (sortbefore(cx, how, A(q), A(t), c)) {e=q; q=B(q); qk--;}
+                    else {e=t; t=B(t); pk--;}
+                }
+                if (tail EQ cx->nilptr) x=e;
+                else Bl(tail)=e;
+                tail=e;
+            }
+            t=q;
+        }
+        Bl(tail)=cx->nilptr;
+        if (merges <= 1) break;
+    }
+    if (r != cx->nilptr) skp=B(B(skp));
+    skp=B(skp);
+    return x;
+}
@@ -0,0 +1,27 @@
+(APPEND (QUOTE (1 2 3 4 5 6 7 8)) (QUOTE (9)))
+(LIST 100 200)
+(SETQ X (APPEND (QUOTE (1 2 3 4 5 6 7 8)) (QUOTE (9))))
+(LIST 100 200 300)
+X
+(APPEND (QUOTE (1 2 . 3)) (QUOTE X))
+(APPEND NIL (QUOTE (1)))
+(SETQ A (QUOTE (1 2 3 4)))
+(SETQ B (CDR A))
+(RPLACD B (QUOTE (9 9)))
+A
+(EQ B (CDR A))
+(RPLACD B NIL)
+A
+(RPLACA (CDR A) 7)
+A
+(SETQ L (LAMBDA (N) (COND ((EQ N 0) NIL) (T (CONS (LIST N N N) (L (DIFFERENCE N 1)))))))
+(CAR (SETQ R (L 200)))
+(CAR (CDR R))
+((LAMBDA (N) (LIST N N)) 5)
+(SETQ X (LIST 1 2 3 4 5))
+(RPLACD (CDR X) (LIST 8 9))
+(SETQ Y (APPEND X (LIST 10)))
+(DOTIMES (I 3000) (LIST I I I))
+X
+Y
+(EQ (CDR (CDR X)) (CDR (CDR Y)))
@@ -0,0 +1,12 @@
+(EQUAL 100000000000000000000 100000000000000000000)
+(EQUAL 100000000000000000000 100000000000000000001)
+(EQUAL (LIST 1 100000000000000000000) (LIST 1 (TIMES 10000000000 10000000000)))
+(EQ 100000000000000000000 (TIMES 10000000000 10000000000))
+(EQUAL (PLUS 9007199254740992 1) 9007199254740993)
+(EQUAL 9007199254740992 9007199254740992.0)
+(EQUAL "abc" "abc")
+(EQUAL "abc" "abd")
+(EQUAL "abc" (STRCAT "ab" "c"))
+(EQUAL (LIST "a" (LIST 1 2)) (CONS "a" (CONS (CONS 1 (CONS 2 NIL)) NIL)))
+(EQUAL (QUOTE (1 . 2)) (CONS 1 3))
+(EQUAL "1" 1)
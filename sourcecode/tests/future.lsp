@@ -0,0 +1,7 @@
+(TOUCH (FUTURE (PLUS 1 2)))
+(TOUCH (FUTURE (READ)))
+(TOUCH (FUTURE (EXIT)))
+(TOUCH (FUTURE (CAR 5)))
+(SETQ F (FUTURE (TOUCH (FUTURE (EXIT)))))
+(TOUCH F)
+(PLUS 3 4)
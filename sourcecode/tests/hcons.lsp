@@ -0,0 +1,16 @@
+(SETQ K (HCONS 1 (HCONS 2 NIL)))
+(EQ K (HCONS 1 (HCONS 2 NIL)))
+(EQ K (CONS 1 (HCONS 2 NIL)))
+(DOTIMES (I 3000) (HCONS I (HCONS (PLUS I 1) NIL)))
+(EQ K (HCONS 1 (HCONS 2 NIL)))
+K
+(HCONS-READ T)
+(SETQ A (QUOTE (X (Y Z))))
+(EQ A (QUOTE (X (Y Z))))
+(EQ (CAR (CDR A)) (CAR (QUOTE ((Y Z)))))
+(DOTIMES (I 3000) (LIST I I))
+(EQ A (QUOTE (X (Y Z))))
+(HCONS-READ NIL)
+(EQ A (QUOTE (X (Y Z))))
+(SORT (HCONS 3 (HCONS 1 (HCONS 2 NIL))) LESSP)
+(HCONS 3 (HCONS 1 (HCONS 2 NIL)))
@@ -0,0 +1,26 @@
+(SETQ CALLS 0)
+(SETQ SQ (LAMBDA (X) (DO (SETQ CALLS (PLUS CALLS 1)) (TIMES X X))))
+(MEMOIZE SQ 2)
+(SQ 3)
+(SQ 3)
+CALLS
+(SQ (QUOTE 4))
+(SQ 5)
+(SQ 4)
+CALLS
+(SQ 3)
+CALLS
+(MEMO-CLEAR SQ)
+(SQ 4)
+CALLS
+(SETQ K (LAMBDA (L) (DO (SETQ CALLS (PLUS CALLS 1)) (CAR (CDR (CDR L))))))
+(MEMOIZE K)
+(K (LIST 1 2 (QUOTE (3 4))))
+(K (LIST 1 2 (QUOTE (3 4))))
+CALLS
+(K (LIST 1 2 100000000000000000000))
+(K (LIST 1 2 100000000000000000000))
+CALLS
+(UNMEMOIZE K)
+(K (LIST 1 2 (QUOTE (3 4))))
+CALLS
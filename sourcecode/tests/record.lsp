@@ -0,0 +1,13 @@
+(SETQ H (OPEN-INPUT "record.lsp"))
+(READ-RECORD H)
+(READ-RECORD H)
+(SETQ N 0)
+(WHILE (NULL (EQ (READ-RECORD H (QUOTE END)) (QUOTE END))) (SETQ N (PLUS N 1)))
+N
+(READ-RECORD H)
+(READ-RECORD H (QUOTE END))
+(CLOSE-INPUT H)
+(SETQ H (OPEN-INPUT "record.lsp"))
+(DOTIMES (I 4) (READ-RECORD H))
+(READ-RECORD H)
+(PLUS 1 2)
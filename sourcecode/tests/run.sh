@@ -0,0 +1,22 @@
+#!/bin/sh
+# Runs the regression tests: builds the interpreter with the C flags given, if
+# any, evaluates every NAME.lsp here with --batch and compares its output with
+# NAME.lsp.expected. With -DGOVOL_GCSTRESS, newloc collects at every
+# allocation, so that a node that nothing keeps is lost at once:
+#     sh tests/run.sh
+#     sh tests/run.sh -DGOVOL_GCSTRESS
+cd "$(dirname "$0")" || exit 1
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+gcc -O2 "$@" -pthread -o "$tmp/govol" ../main.c -lm 2>/dev/null || { echo "build failed"; exit 1; }
+cp ../lispinit *.lsp "$tmp"
+fail=0
+for t in *.lsp
+do
+    (cd "$tmp" && ./govol --batch "$t" >/dev/null 2>&1)
+    if cmp -s "$t.expected" "$tmp/$t.out"
+    then echo "ok      $t"
+    else echo "FAILED  $t"; diff "$t.expected" "$tmp/$t.out" | head -20; fail=1
+    fi
+done
+exit $fail
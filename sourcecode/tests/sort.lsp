@@ -0,0 +1,10 @@
+(SETQ S (CONS 3 (CONS 1 (CONS 2 NIL))))
+(SORT S LESSP)
+S
+(SETQ S (LIST 5 4 3 2 1))
+(SORT S (LAMBDA (X Y) (LESSP X Y)))
+S
+(SORT (QUOTE ((B 2) (A 1) (C 2) (D 1))) (LAMBDA (X Y) (LESSP (CAR (CDR X)) (CAR (CDR Y)))))
+(SORT (LIST 100000000000000000000 1 -100000000000000000000) GREATERP)
+(SORT (LIST 7) LESSP)
+(SORT NIL LESSP)
@@ -0,0 +1,10 @@
+(SUM)
+(PRODUCT)
+(SUM 1 2 3 4.5)
+(PRODUCT 2 3.5)
+(PRODUCT 4294967296 4294967296 4294967296)
+(SUM 9007199254740991 1 1 -3)
+(PRODUCT 9007199254740992 0.5)
+(SUM 100000000000000000000 -100000000000000000000 5)
+(PRODUCT 1.5 9007199254740993)
+(SUM 1 (QUOTE A))
@@ -0,0 +1,69 @@
+/* Decoder for the binary trace files written by the GOVOL LISP interpreter.
+
+   While tracing is on (!TRACE), seval records its inputs and results into a
+   ring buffer. (TRACE-DUMP), or any error, writes the buffer into lisp.trace
+   together with the atom table, the number table and the list areas. This
+   program loads those tables back and prints the events with swrite:
+
+     3 eval: (F (DIFFERENCE N 1))   [F]  +1520ns
+
+   The list area is the one at the time of the dump, so a list cell that was
+   reclaimed and reused after its event was recorded prints its new contents.
+
+   Build and run (in the sourcecode directory):
+     gcc -O2 -pthread -o tracedump tracedump.c -lm
+     ./tracedump [lisp.trace]
+*/
+#define GOVOL_NOMAIN
+#include "main.c"
+
+int main(int argc, char **argv)
+{
+    struct Tracehdr h;
+    struct Tevent ev;
+    FILE *f;
+    int32 i, d;
+    int64_t t0;
+    char *fname = (argc > 1)? argv[1] : "lisp.trace";
+    struct Lispctx *cx;
+
+    if ((f=fopen(fname, "rb")) EQ NULL)
+    {
+        fprintf(stderr, "tracedump: cannot open %s\n", fname);
+        return 1;
+    }
+    if (fread(&h, sizeof(h), 1, f) != 1 || strcmp(h.magic, TRACEMAGIC) != 0
+        || h.natoms != m || h.nnum != n || h.ncells != l || h.nwords != lc)
+    {
+        fprintf(stderr, "tracedump: %s is not a trace of this interpreter build\n", fname);
+        return 1;
+    }
+
+    /* swrite only needs the tables and the output buffer, not initlisp() */
+    cx = (struct Lispctx *)calloc(1, sizeof(struct Lispctx));
+    cx->sout = (char *)calloc(80, sizeof(char));
+    cx->P = (struct Listarea *)calloc(l, sizeof(struct Listarea));
+    cx->Cw = (int32 *)calloc(lc, sizeof(int32));
+    cx->Cc = (char *)calloc(lc, sizeof(char));
+    cx->outfp = stdout;
+    cx->logfilep = NULL;
+    fread(cx->Atab, sizeof(struct Atomtable), m, f);
+    fread(cx->Ntab, sizeof(union Numbertabe), n, f);
+    fread(cx->P, sizeof(struct Listarea), l, f);
+    fread(cx->Cw, sizeof(int32), lc, f);
+    fread(cx->Cc, sizeof(char), lc, f);
+    cx->nilptr = ordatom(cx, "NIL");    /* found, not added: NIL is always in the table */
+
+    for (i=0; i<h.nevents && fread(&ev, sizeof(ev), 1, f) EQ 1; i++)
+    {
+        if (i EQ 0) t0 = ev.t;
+        for (d=1; d<ev.depth && d<40; d++) printf(" ");
+        printf("%d %s ", ev.depth, (ev.osw EQ 1)? "result:" : "eval:");
+        fflush(stdout);
+        swrite(cx, ev.ptr);
+        if (ev.fn >= 0) printf("   [%s]", cx->Atab[ev.fn].name);
+        printf("  +%ldns\n", (long)(ev.t-t0));
+    }
+    fclose(f);
+    return 0;
+}